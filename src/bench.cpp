@@ -0,0 +1,427 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "engine.h"
+#include "treegen.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#endif
+
+// explorer-bench: generates a synthetic tree and times listing it (GetFiles),
+// a full size scan (StartFolderScan) and a disk search (SearchFiles) at
+// several thread counts. The report is JSON on stdout (or --out), a summary
+// table goes to stderr.
+
+#define BENCH_REPORT_VERSION 1
+
+struct BenchOptions {
+	File::TreeSpec spec;
+	std::string directory; // parent of the generated tree
+	std::string out;
+	std::string query = "ab";
+	std::vector<unsigned> threads;
+	int repeat = 3;
+	bool keep = false;
+	bool reuse = false;
+	bool verbose = false;
+};
+
+struct BenchRun {
+	std::string benchmark;
+	unsigned threads = 0;
+	std::vector<double> milliseconds; // one per repetition
+	uint64_t entries = 0;
+	uint64_t directories = 0;
+	uint64_t matches = 0;
+	uint64_t peakRssKb = 0;
+	bool verified = true;
+};
+
+static void PrintUsage()
+{
+	File::TreeSpec spec;
+	std::fprintf(stderr,
+		"usage: explorer-bench [options]\n"
+		"\n"
+		"tree:\n"
+		"  --dir <path>          where to create the tree (default: /dev/shm, else the temp folder)\n"
+		"  --depth <n>           folder levels (default: %u)\n"
+		"  --fanout <n>          sub folders per folder (default: %u)\n"
+		"  --files <n>           files per folder (default: %u)\n"
+		"  --name-length <a-b>   usual name lengths (default: %u-%u)\n"
+		"  --long-names <p>      percent of names up to --long-length (default: %u)\n"
+		"  --long-length <n>     (default: %u)\n"
+		"  --wide <n>            extra folders holding --wide-files files each (default: %u)\n"
+		"  --wide-files <n>      (default: %u)\n"
+		"  --seed <n>            (default: %llu)\n"
+		"  --reuse               benchmark the tree left by an earlier --keep run\n"
+		"  --keep                don't delete the tree afterwards\n"
+		"\n"
+		"runs:\n"
+		"  --threads <a,b,..>    worker counts (default: 1, 2, 4, ... up to the hardware threads)\n"
+		"  --repeat <n>          timed runs per benchmark, the report keeps each (default: 3)\n"
+		"  --query <text>        search query (default: ab)\n"
+		"  --out <file>          write the report there instead of stdout\n"
+		"  --verbose             keep the engine's own log on stderr\n",
+		spec.depth, spec.fanOut, spec.filesPerFolder, spec.minNameLength, spec.maxNameLength, spec.longNamePercent,
+		spec.longNameLength, spec.wideFolders, spec.wideFolderFiles, (unsigned long long)spec.seed);
+}
+
+static std::vector<unsigned> ParseThreadList(const std::string& text)
+{
+	std::vector<unsigned> threads;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		unsigned count = (unsigned)std::strtoul(item.c_str(), nullptr, 10);
+		if (count > 0)
+			threads.push_back(count);
+	}
+	return threads;
+}
+
+static bool ParseArguments(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		auto number = [&]() { i++; return (uint32_t)std::strtoul(value, nullptr, 10); };
+
+		if (arg == "--keep")
+			options.keep = true;
+		else if (arg == "--reuse")
+			options.reuse = true;
+		else if (arg == "--verbose")
+			options.verbose = true;
+		else if (!value)
+			return false;
+		else if (arg == "--dir")
+			options.directory = argv[++i];
+		else if (arg == "--out")
+			options.out = argv[++i];
+		else if (arg == "--query")
+			options.query = argv[++i];
+		else if (arg == "--threads")
+			options.threads = ParseThreadList(argv[++i]);
+		else if (arg == "--repeat")
+			options.repeat = std::max(1, (int)number());
+		else if (arg == "--depth")
+			options.spec.depth = number();
+		else if (arg == "--fanout")
+			options.spec.fanOut = number();
+		else if (arg == "--files")
+			options.spec.filesPerFolder = number();
+		else if (arg == "--long-names")
+			options.spec.longNamePercent = number();
+		else if (arg == "--long-length")
+			options.spec.longNameLength = number();
+		else if (arg == "--wide")
+			options.spec.wideFolders = number();
+		else if (arg == "--wide-files")
+			options.spec.wideFolderFiles = number();
+		else if (arg == "--seed")
+			options.spec.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--name-length")
+		{
+			const char* dash = std::strchr(value, '-');
+			options.spec.minNameLength = (uint32_t)std::strtoul(value, nullptr, 10);
+			options.spec.maxNameLength = dash ? (uint32_t)std::strtoul(dash + 1, nullptr, 10) : options.spec.minNameLength;
+			i++;
+		}
+		else
+			return false;
+	}
+
+	if (options.spec.minNameLength == 0 || options.spec.maxNameLength < options.spec.minNameLength)
+		return false;
+
+	if (options.threads.empty())
+	{
+		unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned count = 1; count < hardware; count *= 2)
+			options.threads.push_back(count);
+		options.threads.push_back(hardware);
+	}
+	return true;
+}
+
+// Peak resident set since the last ResetPeakRss, in KB. Windows can't reset
+// it, so there it is the peak of the whole run so far.
+static void ResetPeakRss()
+{
+#ifndef _WIN32
+	std::ofstream clear("/proc/self/clear_refs");
+	if (clear)
+		clear << "5";
+#endif
+}
+
+static uint64_t PeakRssKb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.rfind("VmHWM:", 0) == 0)
+			return std::strtoull(line.c_str() + 6, nullptr, 10);
+	}
+	return 0;
+#endif
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Lists every folder under `path` with GetFiles, one task per folder, the
+// way browsing would read them.
+static void EnumerateTree(const std::shared_ptr<File::TaskGroup>& group, std::string path, std::atomic<uint64_t>& entries, std::atomic<uint64_t>& directories)
+{
+	auto files = File::GetFiles(path);
+	entries += files.first.size() + files.second.size();
+	directories += 1;
+
+	for (const auto& folder : files.second)
+	{
+		std::string child = File::JoinPath(path, folder.name);
+		File::ScanPool.Submit(group, [group, child = std::move(child), &entries, &directories]() {
+			EnumerateTree(group, child, entries, directories);
+		});
+	}
+}
+
+static void RunEnumerate(const std::string& root, BenchRun& run)
+{
+	std::atomic<uint64_t> entries(0), directories(0);
+	auto start = std::chrono::steady_clock::now();
+	auto group = std::make_shared<File::TaskGroup>();
+	File::ScanPool.Submit(group, [group, root, &entries, &directories]() {
+		EnumerateTree(group, root, entries, directories);
+	});
+	group->Wait();
+	run.milliseconds.push_back(MillisecondsSince(start));
+
+	run.entries = entries;
+	run.directories = directories;
+}
+
+static void RunSizeScan(const std::string& root, const File::TreeStats& stats, BenchRun& run)
+{
+	File::ResetScanCounters();
+	File::startScanTime = std::chrono::steady_clock::now();
+	File::NodeId node = File::Nodes.Intern(root);
+
+	auto start = std::chrono::steady_clock::now();
+	auto group = File::StartFolderScan(node);
+	if (group)
+		group->Wait();
+	run.milliseconds.push_back(MillisecondsSince(start));
+
+	run.entries = (uint64_t)File::currentPropertiesFileCount + File::currentPropertiesFolderCount;
+	run.directories = File::currentPropertiesFolderCount + 1;
+
+	std::lock_guard<File::CountingMutex> lock(File::resultsMutex);
+	auto it = File::FolderSizeCache.find(node);
+	if (stats.files > 0 && (it == File::FolderSizeCache.end() || it->second != stats.bytes))
+		run.verified = false;
+}
+
+static void RunSearch(const std::string& query, const File::TreeStats& stats, BenchRun& run)
+{
+	auto start = std::chrono::steady_clock::now();
+	if (!File::Search(query))
+	{
+		run.verified = false;
+		return;
+	}
+	File::searchGroup->Wait();
+	File::MergeSearchResults();
+	run.milliseconds.push_back(MillisecondsSince(start));
+
+	// A disk search visits the whole tree
+	run.entries = stats.files + stats.folders;
+	run.directories = stats.folders + 1;
+	run.matches = File::searchJob->ranking.Matches();
+}
+
+static double Median(std::vector<double> values)
+{
+	if (values.empty())
+		return 0.0;
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+static void WriteReport(std::ostream& out, const BenchOptions& options, const File::TreeStats& stats,
+	double generateMilliseconds, const std::vector<BenchRun>& runs)
+{
+	const File::TreeSpec& spec = options.spec;
+	out << "{\n  \"version\": " << BENCH_REPORT_VERSION << ",\n";
+	out << "  \"platform\": \"" <<
+#ifdef _WIN32
+		"windows"
+#else
+		"linux"
+#endif
+		<< "\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+
+	out << "  \"tree\": {\"depth\": " << spec.depth << ", \"fanout\": " << spec.fanOut << ", \"files_per_folder\": " << spec.filesPerFolder
+		<< ", \"name_length\": [" << spec.minNameLength << ", " << spec.maxNameLength << "], \"long_name_percent\": " << spec.longNamePercent
+		<< ", \"long_name_length\": " << spec.longNameLength << ", \"wide_folders\": " << spec.wideFolders << ", \"wide_folder_files\": "
+		<< spec.wideFolderFiles << ", \"seed\": " << spec.seed << ",\n    \"files\": " << stats.files << ", \"folders\": " << stats.folders
+		<< ", \"bytes\": " << stats.bytes << ", \"generate_ms\": " << generateMilliseconds << "},\n";
+
+	out << "  \"query\": \"";
+	for (char c : options.query)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\';
+		out << c;
+	}
+	out << "\",\n  \"runs\": [\n";
+
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		const BenchRun& run = runs[i];
+		double median = Median(run.milliseconds);
+		double seconds = median / 1000.0;
+
+		out << "    {\"benchmark\": \"" << run.benchmark << "\", \"threads\": " << run.threads << ", \"wall_ms\": " << median
+			<< ", \"wall_ms_min\": " << (run.milliseconds.empty() ? 0.0 : *std::min_element(run.milliseconds.begin(), run.milliseconds.end()))
+			<< ", \"repeat\": " << run.milliseconds.size() << ", \"entries\": " << run.entries << ", \"directories\": " << run.directories
+			<< ", \"entries_per_sec\": " << (uint64_t)(seconds > 0.0 ? run.entries / seconds : 0.0)
+			<< ", \"directories_per_sec\": " << (uint64_t)(seconds > 0.0 ? run.directories / seconds : 0.0);
+		if (run.benchmark == "search")
+			out << ", \"matches\": " << run.matches;
+		out << ", \"peak_rss_kb\": " << run.peakRssKb << ", \"verified\": " << (run.verified ? "true" : "false") << "}"
+			<< (i + 1 < runs.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseArguments(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	// The report owns stdout; the engine's progress messages are noise here
+	std::streambuf* log = std::cout.rdbuf(options.verbose ? std::cerr.rdbuf() : nullptr);
+
+	if (options.directory.empty())
+	{
+		std::error_code error;
+		options.directory = fs::is_directory("/dev/shm", error) ? "/dev/shm" : fs::temp_directory_path(error).string();
+	}
+	fs::path tree = fs::path(options.directory) / ("explorer-bench-" + std::to_string(options.spec.seed));
+	std::string root = tree.string();
+
+	File::TreeStats stats;
+	double generateMilliseconds = 0.0;
+	if (options.reuse && fs::is_directory(tree))
+	{
+		// Counted rather than trusted: the tree may come from another spec
+		for (const auto& entry : fs::recursive_directory_iterator(tree))
+		{
+			if (entry.is_directory())
+				stats.folders++;
+			else
+			{
+				stats.files++;
+				stats.bytes += entry.file_size();
+			}
+		}
+	}
+	else
+	{
+		std::cerr << "Generating " << root << "\n";
+		auto start = std::chrono::steady_clock::now();
+		File::TreeGenerator generator(options.spec);
+		if (!generator.Generate(tree, stats))
+			return 1;
+		generateMilliseconds = MillisecondsSince(start);
+	}
+	std::cerr << stats.files << " files, " << stats.folders << " folders, " << File::FormatFileSize(stats.bytes) << "\n";
+
+	File::watchChanges = false;
+	File::useNameIndex = false;
+	File::getFolderSizeOnSearch = false;
+	File::incrementalScan = false;
+	File::searchDepthMax = (int)options.spec.depth + 2;
+	File::storageRoots = { root };
+
+	struct Benchmark {
+		const char* name;
+		std::function<void(BenchRun&)> run;
+	};
+	const Benchmark benchmarks[] = {
+		{ "enumerate", [&](BenchRun& run) { RunEnumerate(root, run); } },
+		{ "size_scan", [&](BenchRun& run) { RunSizeScan(root, stats, run); } },
+		{ "search", [&](BenchRun& run) { RunSearch(options.query, stats, run); } },
+	};
+
+	std::vector<BenchRun> runs;
+	for (unsigned threads : options.threads)
+	{
+		File::ScanPool.Stop();
+		File::ScanPool.Start(threads);
+
+		for (const Benchmark& benchmark : benchmarks)
+		{
+			BenchRun run;
+			run.benchmark = benchmark.name;
+			run.threads = threads;
+
+			benchmark.run(run); // warm-up, not timed
+			run.milliseconds.clear();
+			ResetPeakRss();
+			for (int i = 0; i < options.repeat; i++)
+				benchmark.run(run);
+			run.peakRssKb = PeakRssKb();
+
+			double seconds = Median(run.milliseconds) / 1000.0;
+			std::fprintf(stderr, "%-10s %3u threads %10.2f ms %12llu entries/s %10llu dirs/s %8llu KB%s\n", run.benchmark.c_str(), threads,
+				seconds * 1000.0, (unsigned long long)(seconds > 0.0 ? run.entries / seconds : 0.0),
+				(unsigned long long)(seconds > 0.0 ? run.directories / seconds : 0.0), (unsigned long long)run.peakRssKb,
+				run.verified ? "" : "  MISMATCH");
+			runs.push_back(std::move(run));
+		}
+	}
+	File::ScanPool.Stop();
+
+	std::cout.rdbuf(log);
+	if (options.out.empty())
+		WriteReport(std::cout, options, stats, generateMilliseconds, runs);
+	else
+	{
+		std::ofstream out(options.out);
+		WriteReport(out, options, stats, generateMilliseconds, runs);
+		std::cerr << "Report written to " << options.out << "\n";
+	}
+
+	if (!options.keep)
+	{
+		std::error_code error;
+		fs::remove_all(tree, error);
+	}
+
+	bool verified = std::all_of(runs.begin(), runs.end(), [](const BenchRun& run) { return run.verified; });
+	return verified ? 0 : 1;
+}
\ No newline at end of file
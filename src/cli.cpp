@@ -0,0 +1,380 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "engine.h"
+
+// explorer-cli: the engine without a window, for scripts and servers.
+// Results go to stdout as NDJSON or CSV; everything the engine logs and the
+// timing summary go to stderr.
+
+enum class OutputFormat { Ndjson, Csv };
+
+struct CliOptions {
+	std::string command;
+	std::vector<std::string> arguments;
+	std::vector<std::string> roots;
+	OutputFormat format = OutputFormat::Ndjson;
+	size_t limit = MAX_RESULTS;
+	bool waitForSizes = true;
+	bool telemetry = false;
+	bool memory = false;
+	std::string trace; // where to export trace spans, if anywhere
+};
+
+static void PrintUsage()
+{
+	std::fprintf(stderr,
+		"usage: explorer-cli <command> [options]\n"
+		"\n"
+		"commands:\n"
+		"  search <query>    rank names matching the query (same syntax as the search box)\n"
+		"  scan              scan the roots, save folder sizes and rebuild the name index\n"
+		"  size <path>...    total size of each path\n"
+		"\n"
+		"options:\n"
+		"  --root <path>     root to scan or search, repeatable (default: /)\n"
+		"  --format <f>      ndjson (default) or csv\n"
+		"  --limit <n>       at most n results (default and maximum: %d)\n"
+		"  --fuzzy           fuzzy name matching\n"
+		"  --no-index        search the disk even for roots the name index covers\n"
+		"  --no-sizes        don't wait for folder sizes before printing results\n"
+		"  --incremental     only reread folders whose mtime changed since the snapshot\n"
+		"                    (faster, but misses files grown in place)\n"
+		"  --full            reread everything (the default)\n"
+		"  --workers <n>     scan threads (default: one per hardware thread)\n"
+		"  --depth <n>       deepest folder below a root a search visits (default: %d)\n"
+		"  --telemetry       print per worker scan counters as JSON to stderr\n"
+		"  --memory          print what the caches and results hold as JSON to stderr\n"
+		"  --size-budget <n> MB the folder size cache keeps after a save, 0 = no limit (default: %d)\n"
+		"  --trace <file>    record trace spans and write them as Chrome trace JSON\n"
+		"  --state-dir <dir> where " SNAPSHOT_FILE " and " NAME_INDEX_FILE " are read and written\n"
+		"                    (default: the working directory)\n"
+		"\n"
+		"Relative paths are taken from the working directory; paths that don't exist are an error.\n",
+		MAX_RESULTS, MAX_SEARCH_DEPTH, FOLDER_SIZE_BUDGET_MB);
+}
+
+static bool ParseArguments(int argc, char** argv, CliOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--root" && hasValue)
+			options.roots.push_back(argv[++i]);
+		else if (arg == "--format" && hasValue)
+		{
+			std::string format = argv[++i];
+			if (format == "ndjson" || format == "json")
+				options.format = OutputFormat::Ndjson;
+			else if (format == "csv")
+				options.format = OutputFormat::Csv;
+			else
+				return false;
+		}
+		else if (arg == "--limit" && hasValue)
+			options.limit = (size_t)std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--fuzzy")
+			File::fuzzySearch = true;
+		else if (arg == "--no-index")
+			File::useNameIndex = false;
+		else if (arg == "--no-sizes")
+			options.waitForSizes = false;
+		else if (arg == "--trace" && hasValue)
+			options.trace = argv[++i];
+		else if (arg == "--telemetry")
+			options.telemetry = true;
+		else if (arg == "--memory")
+			options.memory = true;
+		else if (arg == "--size-budget" && hasValue)
+			File::folderSizeBudgetMB = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--incremental")
+			File::incrementalScan = true;
+		else if (arg == "--full")
+			File::incrementalScan = false;
+		else if (arg == "--workers" && hasValue)
+			File::scanWorkerCount = std::atoi(argv[++i]);
+		else if (arg == "--depth" && hasValue)
+			File::searchDepthMax = std::atoi(argv[++i]);
+		else if (arg == "--state-dir" && hasValue)
+			File::stateDirectory = argv[++i];
+		else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-')
+			return false;
+		else if (options.command.empty())
+			options.command = arg;
+		else
+			options.arguments.push_back(arg);
+	}
+	return !options.command.empty();
+}
+
+// Makes `argument` an absolute path the node table can intern, or reports
+// why it can't. Roots are interned like drive roots, so trailing separators
+// would make a second node for the same folder.
+static bool ResolvePath(const std::string& argument, std::string& path)
+{
+	std::error_code error;
+	fs::path absolute = fs::absolute(argument, error);
+	if (error || !fs::exists(absolute, error))
+	{
+		std::cerr << argument << ": " << (error ? error.message() : "no such file or folder") << "\n";
+		return false;
+	}
+
+	path = absolute.lexically_normal().string();
+	while (path.size() > 1 && File::IsPathSeparator(path.back()))
+		path.pop_back();
+	return true;
+}
+
+static void WriteJsonString(std::string_view text)
+{
+	std::putchar('"');
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '"': std::fputs("\\\"", stdout); break;
+		case '\\': std::fputs("\\\\", stdout); break;
+		case '\n': std::fputs("\\n", stdout); break;
+		case '\r': std::fputs("\\r", stdout); break;
+		case '\t': std::fputs("\\t", stdout); break;
+		default:
+			if ((unsigned char)c < 0x20)
+				std::printf("\\u%04x", (unsigned char)c);
+			else
+				std::putchar(c);
+		}
+	}
+	std::putchar('"');
+}
+
+static void WriteCsvField(std::string_view text)
+{
+	if (text.find_first_of(",\"\r\n") == std::string_view::npos)
+	{
+		std::fwrite(text.data(), 1, text.size(), stdout);
+		return;
+	}
+
+	std::putchar('"');
+	for (char c : text)
+	{
+		if (c == '"')
+			std::putchar('"');
+		std::putchar(c);
+	}
+	std::putchar('"');
+}
+
+// Seconds since 1970, or 0 for times before it
+static int64_t UnixSeconds(const FILETIME& fileTime)
+{
+	uint64_t ticks = File::FileTimeKey(fileTime);
+	return ticks < FILETIME_UNIX_EPOCH ? 0 : (int64_t)((ticks - FILETIME_UNIX_EPOCH) / 10000000);
+}
+
+static void WriteResult(const SearchResult& result, OutputFormat format)
+{
+	bool folder = result.type.empty();
+	if (format == OutputFormat::Csv)
+	{
+		WriteCsvField(result.path);
+		std::printf(",%s,", folder ? "folder" : "file");
+		WriteCsvField(result.type);
+		std::printf(",%llu,%lld,%d\n", (unsigned long long)result.size, (long long)UnixSeconds(result.last_changed), result.score);
+		return;
+	}
+
+	std::fputs("{\"path\":", stdout);
+	WriteJsonString(result.path);
+	std::printf(",\"kind\":\"%s\",\"type\":", folder ? "folder" : "file");
+	WriteJsonString(result.type);
+	std::printf(",\"size\":%llu,\"modified\":%lld,\"score\":%d}\n",
+		(unsigned long long)result.size, (long long)UnixSeconds(result.last_changed), result.score);
+}
+
+// Total of a scanned folder: empty in CSV, null in JSON when it isn't known
+// (a sub folder was left out because the node table is full).
+static std::string FolderSizeText(File::NodeId node, OutputFormat format)
+{
+	std::lock_guard<File::CountingMutex> lock(File::resultsMutex);
+	auto it = File::FolderSizeCache.find(node);
+	if (it == File::FolderSizeCache.end())
+		return format == OutputFormat::Csv ? "" : "null";
+	return std::to_string(it->second);
+}
+
+static int RunSearch(const CliOptions& options)
+{
+	if (options.arguments.empty())
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::string query;
+	for (const auto& argument : options.arguments)
+		query += (query.empty() ? "" : " ") + argument;
+
+	if (!File::Search(query))
+		return 1;
+
+	File::searchGroup->Wait();
+	if (options.waitForSizes)
+		File::searchJob->sizeScans->Wait();
+
+	File::MergeSearchResults();
+	if (File::resortResults)
+		File::SortResults();
+
+	if (options.format == OutputFormat::Csv)
+		std::fputs("path,kind,type,size,modified,score\n", stdout);
+
+	size_t count = std::min(options.limit, File::results2.size());
+	for (size_t i = 0; i < count; i++)
+		WriteResult(File::results2[i], options.format);
+
+	std::cerr << "{\"command\":\"search\",\"results\":" << count << ",\"matches\":" << File::searchJob->ranking.Matches()
+		<< ",\"index\":" << (File::searchJob->indexFolders.empty() ? "false" : "true") << "}\n";
+	return 0;
+}
+
+static int RunScan(const CliOptions& options)
+{
+	for (const auto& root : File::storageRoots)
+	{
+		auto group = File::StartStorageScan(root);
+		if (!group)
+			continue;
+		group->Wait();
+
+		std::string size = FolderSizeText(File::Nodes.Intern(root), options.format);
+
+		if (options.format == OutputFormat::Csv)
+		{
+			WriteCsvField(root);
+			std::printf(",%s,%u,%u,%u,%u,%lld\n", size.c_str(), File::currentPropertiesFileCount.load(),
+				File::currentPropertiesFolderCount.load(), File::scanRereadCount.load(), File::scanRevalidatedCount.load(),
+				(long long)File::elapsedScanTime.load().count());
+			continue;
+		}
+
+		std::fputs("{\"root\":", stdout);
+		WriteJsonString(root);
+		std::printf(",\"size\":%s,\"files\":%u,\"folders\":%u,\"read\":%u,\"unchanged\":%u,\"milliseconds\":%lld}\n",
+			size.c_str(), File::currentPropertiesFileCount.load(), File::currentPropertiesFolderCount.load(),
+			File::scanRereadCount.load(), File::scanRevalidatedCount.load(), (long long)File::elapsedScanTime.load().count());
+	}
+	return 0;
+}
+
+static int RunSize(const CliOptions& options)
+{
+	if (options.arguments.empty())
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	if (options.format == OutputFormat::Csv)
+		std::fputs("path,size,files,folders\n", stdout);
+
+	int status = 0;
+	for (const auto& argument : options.arguments)
+	{
+		std::string path;
+		if (!ResolvePath(argument, path))
+		{
+			status = 1;
+			continue;
+		}
+		File::NodeId node = File::Nodes.Intern(path);
+
+		auto group = File::StartGetFileSize(path);
+		if (group)
+			group->Wait();
+
+		std::string size = FolderSizeText(node, options.format);
+
+		if (options.format == OutputFormat::Csv)
+		{
+			WriteCsvField(path);
+			std::printf(",%s,%u,%u\n", size.c_str(), File::currentPropertiesFileCount.load(), File::currentPropertiesFolderCount.load());
+			continue;
+		}
+
+		std::fputs("{\"path\":", stdout);
+		WriteJsonString(path);
+		std::printf(",\"size\":%s,\"files\":%u,\"folders\":%u}\n",
+			size.c_str(), File::currentPropertiesFileCount.load(), File::currentPropertiesFolderCount.load());
+	}
+	return status;
+}
+
+int main(int argc, char** argv)
+{
+	CliOptions options;
+	if (!ParseArguments(argc, argv, options) || (options.command != "search" && options.command != "scan" && options.command != "size"))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	// The engine logs progress to std::cout; keep stdout for results
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	if (options.roots.empty())
+		options.roots.push_back(std::string(1, PATH_SEPARATOR));
+	for (const auto& root : options.roots)
+	{
+		std::string path;
+		if (!ResolvePath(root, path))
+			return 1;
+		File::storageRoots.push_back(path);
+	}
+
+	std::error_code error;
+	if (!File::stateDirectory.empty() && !fs::is_directory(File::stateDirectory, error))
+	{
+		std::cerr << File::stateDirectory << ": not a folder\n";
+		return 1;
+	}
+
+	if (options.format == OutputFormat::Csv && options.command == "scan")
+		std::fputs("root,size,files,folders,read,unchanged,milliseconds\n", stdout);
+
+	if (!options.trace.empty())
+	{
+		File::Tracing.NameThread("main");
+		File::Tracing.SetEnabled(true);
+	}
+
+	// One-shot runs have nothing to keep current
+	File::watchChanges = false;
+	File::InitEngine();
+
+	auto start = std::chrono::steady_clock::now();
+	int status = 0;
+	if (options.command == "search")
+		status = RunSearch(options);
+	else if (options.command == "scan")
+		status = RunScan(options);
+	else
+		status = RunSize(options);
+
+	std::fflush(stdout);
+	auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+	std::cerr << "{\"milliseconds\":" << elapsed.count() << ",\"workers\":" << File::ScanPool.WorkerCount() << "}\n";
+	if (options.telemetry)
+		std::cerr << File::TelemetryJson(File::Telemetry.Aggregate(File::ScanPool)) << "\n";
+	if (options.memory)
+		std::cerr << File::MemoryJson(File::EngineMemory()) << "\n";
+	if (!options.trace.empty() && !File::Tracing.Export(options.trace.c_str()))
+		std::cerr << "Couldn't write " << options.trace << "\n";
+
+	File::ScanPool.Stop();
+	return status;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#include "enumerate.h"
+
+#define CELL_TEXT_SIZE 24 // longest cell is a size like "16777216.00 TB"
+
+namespace File {
+
+	// Preformatted text for one table cell, stored inline in the row so that
+	// drawing it neither formats nor allocates. Rows fill these in when their
+	// data arrives and again only when the value behind one changes.
+	struct CellText {
+		char text[CELL_TEXT_SIZE] = {};
+
+		const char* c_str() const { return text; }
+		bool empty() const { return text[0] == '\0'; }
+	};
+
+	static char* PutDigits(char* p, int value, int width)
+	{
+		for (int i = width - 1; i >= 0; i--)
+		{
+			p[i] = (char)('0' + value % 10);
+			value /= 10;
+		}
+		return p + width;
+	}
+
+	// "12.34 MB", the same as the old ostringstream version with two decimals.
+	static void FormatSize(uint64_t size, CellText& out)
+	{
+		constexpr uint64_t KB = 1024;
+		constexpr uint64_t MB = 1024 * KB;
+		constexpr uint64_t GB = 1024 * MB;
+		constexpr uint64_t TB = 1024 * GB;
+
+		char* p = out.text;
+		char* end = out.text + CELL_TEXT_SIZE - 4; // room for the unit
+		const char* unit = " B";
+		if (size < KB)
+			p = std::to_chars(p, end, size).ptr;
+		else
+		{
+			uint64_t scale = size >= TB ? TB : size >= GB ? GB : size >= MB ? MB : KB;
+			unit = scale == TB ? " TB" : scale == GB ? " GB" : scale == MB ? " MB" : " KB";
+			p = std::to_chars(p, end, (double)size / (double)scale, std::chars_format::fixed, 2).ptr;
+		}
+		size_t length = strlen(unit);
+		memcpy(p, unit, length + 1);
+	}
+
+	// "yyyy-mm-dd hh:mm" in local time; empty if the time can't be converted.
+	static void FormatDate(uint64_t fileTime, CellText& out)
+	{
+		out.text[0] = '\0';
+		if (fileTime < FILETIME_UNIX_EPOCH)
+			return;
+
+		time_t seconds = (time_t)((fileTime - FILETIME_UNIX_EPOCH) / 10000000);
+		struct tm tm;
+#ifdef _WIN32
+		if (localtime_s(&tm, &seconds) != 0)
+			return;
+#else
+		if (!localtime_r(&seconds, &tm))
+			return;
+#endif
+
+		char* p = out.text;
+		p = PutDigits(p, tm.tm_year + 1900, 4);
+		*p++ = '-';
+		p = PutDigits(p, tm.tm_mon + 1, 2);
+		*p++ = '-';
+		p = PutDigits(p, tm.tm_mday, 2);
+		*p++ = ' ';
+		p = PutDigits(p, tm.tm_hour, 2);
+		*p++ = ':';
+		p = PutDigits(p, tm.tm_min, 2);
+		*p = '\0';
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,1905 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "enumerate.h"
+#include "nodes.h"
+#include "executor.h"
+#include "snapshot.h"
+#include "watcher.h"
+#include "trigram.h"
+#include "matcher.h"
+#include "query.h"
+#include "rank.h"
+#include "sortkeys.h"
+#include "display.h"
+#include "telemetry.h"
+#include "memory.h"
+
+#define MAX_RESULTS 1000
+#define MAX_SEARCH_DEPTH 10
+#define GET_FOLDER_SIZE_ON_SEARCH true
+#define SCAN_BATCH_SIZE 16
+#define INCREMENTAL_SCAN false // opt-in: trusts folder mtimes, which miss files grown in place
+#define WATCH_CHANGES true
+#define USE_NAME_INDEX true
+#define FOLDER_SIZE_BUDGET_MB 256 // folder size cache limit, 0 = none; what is trimmed stays in the snapshot
+#define FOLDER_SIZE_TRIM_PERCENT 90 // a trim goes this far under the budget so the next save doesn't trim again
+
+#ifndef _WIN32
+// Times keep the Win32 layout everywhere so rows look the same to both front ends
+struct FILETIME {
+	uint32_t dwLowDateTime;
+	uint32_t dwHighDateTime;
+};
+#endif
+
+namespace fs = std::filesystem;
+
+// The scanning and search engine: everything the window drives that doesn't
+// draw anything, so the command line front end (cli.cpp) can drive it too.
+namespace File {
+
+	std::string fileTimeToString(FILETIME last_changed) {
+		CellText text;
+		FormatDate(((uint64_t)last_changed.dwHighDateTime << 32) | last_changed.dwLowDateTime, text);
+		return std::string(text.c_str());
+	}
+
+	// The sort keys and display text are filled in with the listing
+	// (FillSortKeys), so sorting never folds a name or converts a date per
+	// comparison and drawing a row never formats one.
+	struct FileInfo {
+		NodeId node = InvalidNode;
+		std::string name;
+		uintmax_t size;
+		std::string type;
+		FILETIME last_changed;
+
+		std::string foldedName;
+		uint64_t changed = 0;
+		uint32_t extension = 0; // rank of the folded type within the listing
+
+		CellText dateText;
+		CellText sizeText;
+	};
+
+	struct FolderInfo {
+		NodeId node = InvalidNode;
+		std::string name;
+		FILETIME last_changed;
+
+		std::string foldedName;
+		uint64_t changed = 0;
+		uint64_t size = 0; // copied from FolderSizeCache (SetFolderSize)
+		bool sizeKnown = false;
+
+		CellText dateText;
+		CellText sizeText; // empty until the size is known
+	};
+
+	// Every folder and file seen by a listing, scan or search, shared by all three
+	NodeTable Nodes;
+	std::unordered_map<NodeId, uint64_t> FolderSizeCache;
+	SizeSnapshot FolderSizeSnapshot; // sizes from earlier sessions, mapped from SNAPSHOT_FILE
+
+	// What a scan saw when it read a folder, so the next scan can tell if it changed
+	struct FolderScanInfo {
+		uint64_t filesSize;
+		uint64_t last_changed;
+	};
+	std::unordered_map<NodeId, FolderScanInfo> FolderScanCache;
+
+	// When each folder's size was last on screen (folderViewClock), for the
+	// trim to keep; folders never shown have no entry.
+	std::unordered_map<NodeId, uint32_t> FolderSizeViews;
+	uint32_t folderViewClock = 1; // UI thread, advanced once per frame
+	int folderSizeBudgetMB = FOLDER_SIZE_BUDGET_MB;
+	std::atomic<uint64_t> folderSizesEvicted(0);
+	static std::string FormatFileSize(uint64_t size) {
+		CellText text;
+		FormatSize(size, text);
+		return std::string(text.c_str());
+	}
+}
+
+struct SearchResult {
+	File::NodeId node = File::InvalidNode;
+	FILETIME last_changed{};
+	std::string type = "";
+	uint64_t size = 0;
+	uint32_t depth = 0;
+	int score = 0;
+	uint64_t id = 0; // order it entered the ranking; breaks ties when sorting
+
+	// Display text, filled in by the thread that ranks it (FillResultText)
+	std::string path{};
+	File::CellText dateText{};
+	File::CellText sizeText{};
+};
+
+namespace File {
+
+	int searchDepthMax = MAX_SEARCH_DEPTH;
+	bool getFolderSizeOnSearch = GET_FOLDER_SIZE_ON_SEARCH;
+	std::vector<std::string> storageRoots; // what a storage scan or disk search covers: the drives, or paths given on the command line
+
+	std::vector<SearchResult> results2;
+	CountingMutex resultsMutex; // FolderSizeCache and friends; results2 is UI thread only
+
+	int resultSortColumn = 5; // the results table's sort, kept so merges can insert in order
+	bool resultSortAscending = false;
+	bool resortResults = false; // results2 isn't in sort order
+
+	std::atomic<bool> showingResults(false);
+	std::atomic<bool> isSearching(false);
+	std::mutex searchStateMutex; // lets a finished search clear isSearching only if no newer one started
+	uint64_t searchGeneration = 0;
+	std::atomic<bool> cancelSearch(false);
+	std::string searchError = ""; // why the last query didn't compile
+	bool fuzzySearch = false;
+
+	// One search: the compiled query and the best MAX_RESULTS found so far,
+	// kept per worker and merged into results2 by the UI.
+	struct SearchJob {
+		SearchJob(SearchQuery compiled, size_t workers)
+			: query(std::move(compiled)), ranking(workers, MAX_RESULTS), now(NowFileTime())
+		{
+			sizeScans->Add(); // the search itself, until its own group is done
+		}
+
+		SearchQuery query;
+		WorkerTopK<SearchResult> ranking;
+		uint64_t now;
+		std::vector<uint32_t> indexFolders; // name index entries of the roots it answers from the index
+		int levels = 1; // how far below a root it looks
+		std::shared_ptr<TaskGroup> sizeScans = std::make_shared<TaskGroup>(); // folder scans started for results
+	};
+	std::shared_ptr<SearchJob> searchJob; // UI thread only
+	double lastMergeMicroseconds = 0.0;
+	double maxMergeMicroseconds = 0.0;
+
+	int scanWorkerCount = 0; // 0 = one per hardware thread
+	int scanBatchSize = SCAN_BATCH_SIZE; // most directories a single scan/search task reads
+	TaskPool ScanPool;
+	std::shared_ptr<TaskGroup> searchGroup;
+	ScanTelemetry Telemetry; // per worker counters for the Properties window and --telemetry
+
+	// Keeps the caches current as folders change on disk. Declared after the
+	// pool so it is stopped first: its callback submits scans.
+	ChangeWatcher Watcher;
+	bool watchChanges = WATCH_CHANGES;
+	std::atomic<NodeId> listedDirectory(InvalidNode); // folder shown by DrawFiles
+	std::atomic<bool> refreshListing(false);
+
+	// Every name seen by a storage scan; lets Search skip the disk entirely
+	NameIndex FileNameIndex;
+	bool useNameIndex = USE_NAME_INDEX;
+	std::atomic<bool> buildingNameIndex(false);
+	std::atomic<bool> nameIndexRequested(false); // asked for while a build was running
+	std::string stateDirectory; // where SNAPSHOT_FILE and NAME_INDEX_FILE are kept, empty = the working directory
+
+	std::atomic<uint64_t> bytesRead(0); // Used for rough progress
+
+	std::atomic<uint64_t> currentPropertiesSize(0);
+	std::atomic<uint32_t> currentPropertiesFileCount(0);
+	std::atomic<uint32_t> currentPropertiesFolderCount(0);
+	std::atomic<int> activeScans(0);
+	bool incrementalScan = INCREMENTAL_SCAN;
+	std::atomic<uint32_t> scanRevalidatedCount(0); // folders an incremental scan didn't have to read
+	std::atomic<uint32_t> scanRereadCount(0);
+
+	std::chrono::steady_clock::time_point startScanTime;
+	std::atomic<std::chrono::milliseconds> elapsedScanTime{}; // of the last finished scan, set by its onDone
+
+#ifdef _WIN32
+	HANDLE modelChangedEvent = nullptr; // auto-reset, created by the window's Init
+#endif
+	std::atomic<uint64_t> modelVersion(0); // bumped by every NotifyModelChanged
+
+	// Wakes an idle window: something it shows changed outside of a frame.
+	static void NotifyModelChanged()
+	{
+		modelVersion.fetch_add(1, std::memory_order_release);
+#ifdef _WIN32
+		if (modelChangedEvent)
+			SetEvent(modelChangedEvent);
+#endif
+	}
+
+	static bool EngineBusy()
+	{
+		return isSearching || activeScans > 0 || buildingNameIndex;
+	}
+
+	std::string toLower(const std::string& str) {
+		std::string result = str;
+		std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) {
+			return std::tolower(c);
+			});
+		return result;
+	}
+
+	// Case-insensitive compare of two node paths; the paths are rebuilt into
+	// per-thread buffers so sorting doesn't allocate for every comparison.
+	static int ComparePathsNoCase(NodeId a, NodeId b)
+	{
+		static thread_local std::string pathA, pathB;
+		Nodes.BuildPath(a, pathA);
+		Nodes.BuildPath(b, pathB);
+
+		size_t length = std::min(pathA.size(), pathB.size());
+		for (size_t i = 0; i < length; i++)
+		{
+			int ca = std::tolower((unsigned char)pathA[i]);
+			int cb = std::tolower((unsigned char)pathB[i]);
+			if (ca != cb)
+				return ca - cb;
+		}
+		return (int)pathA.size() - (int)pathB.size();
+	}
+
+	std::string ExtractFileType(const std::string& fileName) {
+		size_t dotPos = fileName.find_last_of('.');
+		if (dotPos != std::string::npos) {
+			return fileName.substr(dotPos + 1); // Extract the extension
+		}
+		return ""; // No extension found
+	}
+
+	static FILETIME ToFileTime(uint64_t ticks)
+	{
+		FILETIME fileTime;
+		fileTime.dwLowDateTime = (uint32_t)(ticks & 0xFFFFFFFF);
+		fileTime.dwHighDateTime = (uint32_t)(ticks >> 32);
+		return fileTime;
+	}
+
+	static uint64_t FileTimeKey(const FILETIME& fileTime)
+	{
+		return ((uint64_t)fileTime.dwHighDateTime << 32) | fileTime.dwLowDateTime;
+	}
+
+	static void FillSortKeys(std::vector<FileInfo>& files, std::vector<FolderInfo>& folders)
+	{
+		std::vector<std::string_view> types;
+		types.reserve(files.size());
+		for (FileInfo& file : files)
+		{
+			file.foldedName = FoldString(file.name);
+			file.changed = FileTimeKey(file.last_changed);
+			types.push_back(file.type);
+			FormatDate(file.changed, file.dateText);
+			FormatSize(file.size, file.sizeText);
+		}
+
+		std::vector<uint32_t> extensions = RankFolded(types);
+		for (size_t i = 0; i < files.size(); i++)
+			files[i].extension = extensions[i];
+
+		for (FolderInfo& folder : folders)
+		{
+			folder.foldedName = FoldString(folder.name);
+			folder.changed = FileTimeKey(folder.last_changed);
+			FormatDate(folder.changed, folder.dateText);
+		}
+	}
+
+	// Returns whether the folder's size changed, re-formatting it if so.
+	static bool SetFolderSize(FolderInfo& folder, bool known, uint64_t size)
+	{
+		if (known == folder.sizeKnown && size == folder.size)
+			return false;
+
+		folder.sizeKnown = known;
+		folder.size = size;
+		if (known)
+			FormatSize(size, folder.sizeText);
+		else
+			folder.sizeText = CellText();
+		return true;
+	}
+
+	static void FillResultText(SearchResult& result)
+	{
+		result.path = Nodes.Path(result.node);
+		FormatDate(FileTimeKey(result.last_changed), result.dateText);
+		FormatSize(result.size, result.sizeText);
+	}
+
+	// The calling thread's telemetry counters.
+	static WorkerCounters& TelemetrySlot()
+	{
+		return Telemetry.Slot(ScanPool.IsWorkerThread() ? ScanPool.WorkerIndex() : TELEMETRY_MAX_WORKERS);
+	}
+
+	// System calls this thread made since it last asked.
+	static uint64_t TakeEnumSyscalls()
+	{
+		static thread_local uint64_t taken = 0;
+		uint64_t count = enumSyscalls - taken;
+		taken = enumSyscalls;
+		return count;
+	}
+
+	// Reads `directoryPath` into `listing` and merges it into the node table.
+	// `ids` receives each entry's node (InvalidNode for relative paths).
+	// `watch` is for folders whose listing or size stays cached (shown or
+	// sized); a disk search passes through far too many to spend watches on.
+	static NodeId ReadDirectory(const std::string& directoryPath, uint32_t flags, DirListing& listing, std::vector<NodeId>& ids, bool watch)
+	{
+		TRACE_SCOPE("ReadDirectory");
+		listing.Clear();
+		listing.flags = flags | EnumFlags_Free;
+		bool opened = EnumerateDirectory(directoryPath, flags, [&listing](const EntryBatch& batch) {
+			listing.Append(batch);
+		});
+
+		NodeId directory = Nodes.Intern(directoryPath);
+		if (directory != InvalidNode)
+			Nodes.SetChildren(directory, listing, ids);
+		else
+			ids.assign(listing.Size(), InvalidNode);
+
+		if (watch && opened && watchChanges)
+			Watcher.Watch(directoryPath);
+
+		WorkerCounters& telemetry = TelemetrySlot();
+		telemetry.directories++;
+		telemetry.entries += listing.Size();
+		telemetry.syscalls += TakeEnumSyscalls();
+		if (!opened)
+			telemetry.errors++;
+		return directory;
+	}
+
+	// A listing for the window; `watch` keeps it current while it is shown.
+	std::pair<std::vector<FileInfo>, std::vector<FolderInfo>> GetFiles(const std::string& directoryPath, bool watch = true) {
+		TRACE_SCOPE("GetFiles");
+		std::vector<FileInfo> files;
+		std::vector<FolderInfo> folders;
+
+		DirListing listing;
+		std::vector<NodeId> ids;
+		ReadDirectory(directoryPath, EnumFlags_All, listing, ids, watch);
+
+		for (size_t i = 0; i < listing.Size(); i++)
+		{
+			const DirEntry& entry = listing.entries[i];
+			if (entry.kind == EntryKind::Folder)
+			{
+				FolderInfo& folderInfo = folders.emplace_back();
+				folderInfo.node = ids[i];
+				folderInfo.name = listing.Name(i);
+				folderInfo.last_changed = ToFileTime(entry.last_changed);
+			}
+			else
+			{
+				FileInfo& fileInfo = files.emplace_back();
+				fileInfo.node = ids[i];
+				fileInfo.name = listing.Name(i);
+				fileInfo.last_changed = ToFileTime(entry.last_changed);
+				fileInfo.type = ExtractFileType(fileInfo.name);
+				fileInfo.size = entry.size;
+			}
+		}
+
+		FillSortKeys(files, folders);
+		return { std::move(files), std::move(folders) };
+	}
+
+	std::pair<std::vector<FileInfo>, std::vector<FolderInfo>> GetFiles2(const std::string& directoryPath) {
+		std::vector<FileInfo> files;
+		std::vector<FolderInfo> folders;
+
+		if (!fs::exists(directoryPath) || !fs::is_directory(directoryPath)) {
+			return { files, folders };
+		}
+
+		for (const auto& entry : fs::directory_iterator(directoryPath)) {
+			try
+			{
+				auto& entry_path = entry.path();
+				auto entry_path_filename = entry_path.filename();
+				std::string entry_path_filename_string = entry_path_filename.string();
+				if (entry.is_directory()) {
+					if (entry_path_filename != "." && entry_path_filename != "..") {
+						FolderInfo folderInfo;
+						folderInfo.name = entry_path_filename_string;
+						//folderInfo.last_changed = fs::last_write_time(entry);
+						folders.push_back(folderInfo);
+					}
+				}
+				else {
+					FileInfo fileInfo;
+					fileInfo.name = entry_path_filename_string;
+					//fileInfo.last_changed = fs::last_write_time(entry);
+					fileInfo.type = ExtractFileType(entry_path_filename_string);
+					fileInfo.size = fs::file_size(entry);
+					files.push_back(fileInfo);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << "\n";
+			}
+
+		}
+
+		FillSortKeys(files, folders);
+		return { files, folders };
+	}
+
+	struct EnumBenchmarkResult {
+		const char* name = "";
+		uint64_t entries = 0;
+		uint64_t folders = 0;
+		double seconds = 0.0;
+	};
+
+	template<typename Lister>
+	static EnumBenchmarkResult BenchmarkWalk(const char* name, const std::string& root, Lister&& lister)
+	{
+		EnumBenchmarkResult result;
+		result.name = name;
+
+		std::vector<std::string> pending = { root };
+		auto start = std::chrono::steady_clock::now();
+		while (!pending.empty())
+		{
+			std::string path = std::move(pending.back());
+			pending.pop_back();
+			lister(path, result, pending);
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return result;
+	}
+
+	// Walks `root` serially once per enumeration path and prints entries/sec to
+	// the debug console. The first walk only warms the OS cache.
+	static void BenchmarkEnumeration(const std::string& root)
+	{
+		std::cout << "Enumeration benchmark: " << root << "\n";
+
+		auto readerWalk = [](EnumBackend backend) {
+			return [backend](const std::string& path, EnumBenchmarkResult& result, std::vector<std::string>& pending) {
+				DirReader reader;
+				if (!reader.Open(path, EnumFlags_All, backend))
+					return;
+
+				DirEntry entry;
+				while (reader.Next(entry))
+				{
+					result.entries++;
+					if (entry.kind == EntryKind::Folder)
+					{
+						result.folders++;
+						pending.push_back(JoinPath(path, entry.name, entry.nameLength));
+					}
+				}
+			};
+		};
+
+		auto getFilesWalk = [](const std::string& path, EnumBenchmarkResult& result, std::vector<std::string>& pending) {
+			auto files = GetFiles(path, false);
+			result.entries += files.first.size() + files.second.size();
+			result.folders += files.second.size();
+			for (const auto& folder : files.second)
+				pending.push_back(JoinPath(path, folder.name));
+		};
+
+		auto getFiles2Walk = [](const std::string& path, EnumBenchmarkResult& result, std::vector<std::string>& pending) {
+			try
+			{
+				auto files = GetFiles2(path);
+				result.entries += files.first.size() + files.second.size();
+				result.folders += files.second.size();
+				for (const auto& folder : files.second)
+					pending.push_back(JoinPath(path, folder.name));
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << "\n";
+			}
+		};
+
+		BenchmarkWalk("warm-up", root, readerWalk(EnumBackend::Native));
+
+		EnumBenchmarkResult benchmarks[] = {
+			BenchmarkWalk("DirReader (native)", root, readerWalk(EnumBackend::Native)),
+			BenchmarkWalk("DirReader (std)", root, readerWalk(EnumBackend::Std)),
+			BenchmarkWalk("DirReader (io_uring)", root, readerWalk(EnumBackend::IoUring)),
+			BenchmarkWalk("GetFiles", root, getFilesWalk),
+			BenchmarkWalk("GetFiles2", root, getFiles2Walk),
+		};
+
+		for (const auto& benchmark : benchmarks)
+		{
+			double entriesPerSecond = benchmark.seconds > 0.0 ? (double)benchmark.entries / benchmark.seconds : 0.0;
+			std::cout << "  " << benchmark.name << ": " << benchmark.entries << " entries, "
+				<< benchmark.folders << " folders in " << benchmark.seconds << "s ("
+				<< (uint64_t)entriesPerSecond << " entries/sec)\n";
+		}
+	}
+
+	bool IsSubstringPresent(const std::string& str, const std::string& substring) {
+		return NameMatcher(substring).Matches(str);
+	}
+
+	// Times NameMatcher against the toLower + find it replaced, on generated
+	// short and long names.
+	static void BenchmarkMatchers()
+	{
+		std::cout << "Matcher benchmark:\n";
+
+		const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-. ";
+		uint32_t seed = 12345;
+		auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+		struct NameSet {
+			const char* label;
+			size_t minLength;
+			size_t maxLength;
+		};
+		const NameSet sets[] = { { "short names (4-16)", 4, 16 }, { "long names (64-200)", 64, 200 } };
+		const char* queries[] = { "e", "txt", "readme", "microsoft.windows" };
+
+		for (const NameSet& set : sets)
+		{
+			std::vector<std::string> names(200000);
+			for (std::string& name : names)
+			{
+				name.resize(set.minLength + next() % (set.maxLength - set.minLength + 1));
+				for (char& c : name)
+					c = alphabet[next() % (sizeof(alphabet) - 1)];
+			}
+
+			for (const char* query : queries)
+			{
+				std::string lowerQuery = toLower(query);
+				auto start = std::chrono::steady_clock::now();
+				size_t findHits = 0;
+				for (const std::string& name : names)
+					findHits += toLower(name).find(lowerQuery) != std::string::npos;
+				double findNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / names.size();
+
+				NameMatcher matcher(query);
+				start = std::chrono::steady_clock::now();
+				size_t matcherHits = 0;
+				for (const std::string& name : names)
+					matcherHits += matcher.Matches(name);
+				double matcherNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / names.size();
+
+				std::cout << "  " << set.label << ", \"" << query << "\": toLower+find " << findNs << " ns/name, NameMatcher "
+					<< matcherNs << " ns/name (" << findHits << (findHits == matcherHits ? " hits" : " hits, MISMATCH") << ")\n";
+			}
+		}
+	}
+
+	// Splits a level into tasks of at most scanBatchSize directories, but
+	// never into so few that workers sit idle on a shallow level.
+	static size_t TaskChunkSize(size_t count)
+	{
+		size_t workers = std::max(1u, ScanPool.WorkerCount());
+		size_t chunk = (count + workers - 1) / workers;
+		return std::clamp<size_t>(chunk, 1, (size_t)std::max(1, scanBatchSize));
+	}
+
+	template<typename Item, typename Fn>
+	static void SubmitChunked(const std::shared_ptr<TaskGroup>& group, const std::vector<Item>& items, Fn fn)
+	{
+		size_t chunk = TaskChunkSize(items.size());
+		for (size_t i = 0; i < items.size(); i += chunk)
+		{
+			std::vector<Item> batch(items.begin() + i, items.begin() + std::min(i + chunk, items.size()));
+			ScanPool.Submit(group, [group, fn, batch = std::move(batch)]() {
+				fn(group, batch);
+			});
+		}
+	}
+
+	// One directory of a running folder scan. `pending` counts its unfinished
+	// sub folders plus one for its own listing; whoever drops it to zero owns
+	// the finished total and hands it on to the parent.
+	struct ScanNode {
+		NodeId node;
+		ScanNode* parent;
+		std::atomic<uint32_t> pending{ 1 };
+		std::atomic<uint64_t> total{ 0 };
+		uint64_t filesSize = 0;
+		uint64_t last_changed = 0; // folder mtime before it was read
+		bool incremental = false;
+		std::atomic<bool> partial{ false }; // a sub folder was left out (node table full)
+
+		ScanNode(NodeId node, ScanNode* parent) : node(node), parent(parent), incremental(parent && parent->incremental) {}
+	};
+
+	// Drops one pending reference. Every folder whose subtree is now complete
+	// is published straight away, walking up until an ancestor is still busy.
+	static void ReleaseScanNode(ScanNode* scan)
+	{
+		while (scan && scan->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			uint64_t total = scan->total.load(std::memory_order_relaxed);
+			bool partial = scan->partial.load(std::memory_order_relaxed);
+			ScanNode* parent = scan->parent;
+
+			// A total missing a sub folder would be wrong, so it stays unknown
+			resultsMutex.lock();
+			if (partial)
+			{
+				FolderSizeCache.erase(scan->node);
+				FolderScanCache.erase(scan->node);
+				FolderSizeViews.erase(scan->node);
+			}
+			else
+			{
+				Nodes.SetSize(scan->node, total);
+				FolderSizeCache[scan->node] = total;
+				if (scan->last_changed != 0)
+					FolderScanCache[scan->node] = { scan->filesSize, scan->last_changed };
+			}
+			resultsMutex.unlock();
+
+			if (parent)
+			{
+				parent->total.fetch_add(total, std::memory_order_relaxed);
+				if (partial)
+					parent->partial.store(true, std::memory_order_relaxed);
+			}
+
+			delete scan;
+			scan = parent;
+		}
+	}
+
+	// An incremental scan trusts a folder whose mtime still matches the one it
+	// had when it was last read: its own files are taken from the snapshot and
+	// only its sub folders are visited (and each checked the same way). A file
+	// rewritten or appended to in place doesn't touch its folder's mtime, so
+	// its new size is missed until a full scan; hence incremental is opt-in.
+	static bool RevalidateDirectory(ScanNode* scan, const std::string& path, std::vector<ScanNode*>& subFolders)
+	{
+		// The names point into the mapping, which a save may replace once
+		// VisitFolder lets go of it; copied here and resolved in one batch.
+		static thread_local std::string childNames;
+		static thread_local std::vector<size_t> childEnds;
+		static thread_local std::vector<std::string_view> names;
+		static thread_local std::vector<NodeId> ids;
+		uint64_t entryCount = 0;
+		childNames.clear();
+		childEnds.clear();
+
+		bool unchanged = FolderSizeSnapshot.VisitFolder(path,
+			[scan, &entryCount](const SnapshotNode& folder) {
+				if (!(folder.flags & SnapshotFlags_Scanned) || folder.last_changed != scan->last_changed)
+					return false;
+
+				scan->filesSize = folder.filesSize;
+				entryCount = (folder.flags & SnapshotFlags_Listed) ? folder.entryCount : 0;
+				return true;
+			},
+			[](std::string_view name, const SnapshotNode&) {
+				childNames.append(name);
+				childEnds.push_back(childNames.size());
+			});
+		if (!unchanged)
+			return false;
+
+		names.clear();
+		for (size_t i = 0, start = 0; i < childEnds.size(); start = childEnds[i++])
+			names.emplace_back(childNames.data() + start, childEnds[i] - start);
+		Nodes.FindOrAddChildren(scan->node, names, EntryKind::Folder, ids);
+		uint32_t folderCount = 0;
+		for (NodeId id : ids)
+		{
+			// Left out once the node table is full, which leaves the total unknown
+			if (id == InvalidNode)
+			{
+				scan->partial.store(true, std::memory_order_relaxed);
+				continue;
+			}
+			subFolders.push_back(new ScanNode(id, scan));
+			folderCount++;
+		}
+		currentPropertiesFileCount += entryCount > folderCount ? (uint32_t)entryCount - folderCount : 0;
+		currentPropertiesFolderCount += folderCount;
+		currentPropertiesSize += scan->filesSize;
+
+		scan->total.fetch_add(scan->filesSize, std::memory_order_relaxed);
+		scan->pending.fetch_add(folderCount, std::memory_order_relaxed);
+		ReleaseScanNode(scan);
+		return true;
+	}
+
+	// Reads each directory, adds its own files to its total and queues its sub
+	// folders as new tasks. Nothing here waits for a subtree.
+	static void ScanDirectories(const std::shared_ptr<TaskGroup>& group, const std::vector<ScanNode*>& directories)
+	{
+		TRACE_SCOPE("ScanDirectories");
+		static thread_local DirListing listing;
+		static thread_local std::vector<NodeId> ids;
+		std::vector<ScanNode*> subFolders;
+
+		for (ScanNode* scan : directories)
+		{
+			std::string path = Nodes.Path(scan->node);
+			if (scan->incremental)
+			{
+				GetLastChanged(path, scan->last_changed);
+				if (scan->last_changed != 0 && RevalidateDirectory(scan, path, subFolders))
+				{
+					scanRevalidatedCount++;
+					WorkerCounters& telemetry = TelemetrySlot();
+					telemetry.revalidated++;
+					telemetry.syscalls += TakeEnumSyscalls();
+					continue;
+				}
+			}
+
+			ReadDirectory(path, EnumFlags_All, listing, ids, true);
+			scanRereadCount++;
+
+			uint64_t filesSize = 0;
+			uint32_t fileCount = 0;
+			uint32_t folderCount = 0;
+			for (size_t i = 0; i < listing.Size(); i++)
+			{
+				const DirEntry& entry = listing.entries[i];
+				if (entry.kind == EntryKind::Folder)
+				{
+					if (ids[i] == InvalidNode)
+					{
+						scan->partial.store(true, std::memory_order_relaxed);
+						continue;
+					}
+					ScanNode* subFolder = subFolders.emplace_back(new ScanNode(ids[i], scan));
+					subFolder->last_changed = entry.last_changed;
+					folderCount++;
+				}
+				else
+				{
+					filesSize += entry.size;
+					fileCount++;
+				}
+			}
+
+			currentPropertiesFileCount += fileCount;
+			currentPropertiesFolderCount += folderCount;
+			currentPropertiesSize += filesSize;
+
+			// The sub folders aren't submitted yet, so they can't finish before this
+			scan->filesSize = filesSize;
+			scan->total.fetch_add(filesSize, std::memory_order_relaxed);
+			scan->pending.fetch_add(folderCount, std::memory_order_relaxed);
+			ReleaseScanNode(scan);
+		}
+
+		SubmitChunked(group, subFolders, [](const std::shared_ptr<TaskGroup>& group, const std::vector<ScanNode*>& batch) {
+			ScanDirectories(group, batch);
+		});
+	}
+
+	// Sizes the tree under `root` on the scan pool without blocking the caller.
+	// Folders show up in FolderSizeCache as their own subtree completes;
+	// `onDone` runs once `root` itself is done. An incremental scan only reads
+	// folders that changed since the snapshot was written.
+	static std::shared_ptr<TaskGroup> StartFolderScan(NodeId root, std::function<void()> onDone = nullptr, bool incremental = false)
+	{
+		if (root == InvalidNode)
+			return nullptr;
+
+		activeScans++;
+		auto group = std::make_shared<TaskGroup>([onDone = std::move(onDone)]() {
+			elapsedScanTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startScanTime);
+			activeScans--;
+
+			if (onDone)
+				onDone();
+			NotifyModelChanged();
+		});
+
+		ScanNode* scan = new ScanNode(root, nullptr);
+		scan->incremental = incremental && FolderSizeSnapshot.Loaded();
+		if (!scan->incremental)
+			GetLastChanged(Nodes.Path(root), scan->last_changed);
+
+		ScanPool.Submit(group, [group, scan]() {
+			ScanDirectories(group, { scan });
+		});
+		return group;
+	}
+
+	// Empties the OS file cache so the next walk is cold. Best effort: needs
+	// root on Linux and isn't offered on Windows.
+	static bool DropFileCaches()
+	{
+#ifdef _WIN32
+		return false;
+#else
+		sync();
+		FILE* file = fopen("/proc/sys/vm/drop_caches", "w");
+		if (!file)
+			return false;
+
+		bool dropped = fputs("3", file) >= 0;
+		return fclose(file) == 0 && dropped;
+#endif
+	}
+
+	// Times a full pool scan of `root` with each enumeration backend, cold (if
+	// the cache can be dropped) and warm, and prints the results.
+	static void BenchmarkScanBackends(const std::string& root)
+	{
+		struct Backend {
+			const char* name;
+			EnumBackend backend;
+		};
+		const Backend backends[] = { { "thread pool + native", EnumBackend::Native }, { "thread pool + io_uring", EnumBackend::IoUring } };
+
+		EnumBackend previous = enumBackend;
+		NodeId node = Nodes.Intern(root);
+		std::cout << "Scan backend benchmark: " << root << " on " << ScanPool.WorkerCount() << " workers\n";
+
+		for (const Backend& backend : backends)
+		{
+			enumBackend = backend.backend;
+			for (const char* cache : { "cold", "warm" })
+			{
+				if (cache[0] == 'c' && !DropFileCaches())
+				{
+					std::cout << "  " << backend.name << " (cold): skipped, can't drop the file cache\n";
+					continue;
+				}
+
+				currentPropertiesFolderCount = 0;
+				currentPropertiesFileCount = 0;
+				auto start = std::chrono::steady_clock::now();
+				auto group = StartFolderScan(node);
+				if (group)
+					group->Wait();
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				uint64_t entries = (uint64_t)currentPropertiesFolderCount + currentPropertiesFileCount;
+				std::cout << "  " << backend.name << " (" << cache << "): " << entries << " entries in " << seconds << "s ("
+					<< (uint64_t)(seconds > 0.0 ? entries / seconds : 0.0) << " entries/sec)\n";
+			}
+		}
+
+		enumBackend = previous;
+	}
+
+	// Fills in the sub folder sizes of a freshly listed directory from the
+	// snapshot, so they show up before anything was scanned this session.
+	static void SeedFolderSizes(const std::string& path, const std::vector<FolderInfo>& folders)
+	{
+		std::unordered_map<std::string_view, NodeId> missing;
+
+		std::lock_guard<CountingMutex> lock(resultsMutex);
+		for (const auto& folder : folders)
+		{
+			if (!FolderSizeCache.count(folder.node))
+				missing.emplace(folder.name, folder.node);
+		}
+		if (missing.empty())
+			return;
+
+		FolderSizeSnapshot.ForEachChild(path, [&missing](std::string_view name, const SnapshotNode& node) {
+			auto it = missing.find(name);
+			if (it == missing.end() || !(node.flags & SnapshotFlags_SizeKnown))
+				return;
+
+			FolderSizeCache[it->second] = node.size;
+			if ((node.flags & SnapshotFlags_Scanned) && !FolderScanCache.count(it->second))
+				FolderScanCache[it->second] = { node.filesSize, node.last_changed };
+		});
+	}
+
+	// Bytes of the folder size cache as the budget counts them: the sizes,
+	// what scans saw and the view times. Expects resultsMutex to be held.
+	static size_t FolderSizeCacheBytes()
+	{
+		return HashMapHeapBytes(FolderSizeCache) + HashMapHeapBytes(FolderScanCache) + HashMapHeapBytes(FolderSizeViews);
+	}
+
+	// Notes that a folder's size is on screen. Expects resultsMutex to be held.
+	static void MarkFolderViewed(NodeId node)
+	{
+		if (FolderSizeCache.count(node))
+			FolderSizeViews[node] = folderViewClock;
+	}
+
+	// Looks up a folder's total. A trimmed one is read back from the
+	// snapshot, which had it when it was trimmed, and cached again.
+	// Expects resultsMutex to be held.
+	static bool FindFolderSize(NodeId node, uint64_t& size)
+	{
+		auto it = FolderSizeCache.find(node);
+		if (it != FolderSizeCache.end())
+		{
+			size = it->second;
+			return true;
+		}
+		if (folderSizesEvicted == 0)
+			return false;
+
+		bool found = false;
+		FolderSizeSnapshot.VisitFolder(Nodes.Path(node), [&](const SnapshotNode& folder) {
+			if (!(folder.flags & SnapshotFlags_SizeKnown))
+				return false;
+
+			found = true;
+			size = folder.size;
+			FolderSizeCache[node] = folder.size;
+			if ((folder.flags & SnapshotFlags_Scanned) && !FolderScanCache.count(node))
+				FolderScanCache[node] = { folder.filesSize, folder.last_changed };
+			return false;
+		}, [](std::string_view, const SnapshotNode&) {});
+		return found;
+	}
+
+	// Brings the folder size cache back under its budget once `sizes` and
+	// `scanned` are safely in the snapshot. Least recently viewed go first,
+	// then the deepest, then the smallest. The top two levels of every sized
+	// tree (a scanned root and its children) are always kept, and so is
+	// anything that changed since the save.
+	static void TrimFolderSizes(const std::unordered_map<NodeId, uint64_t>& sizes, const std::unordered_map<NodeId, FolderScanInfo>& scanned)
+	{
+		if (folderSizeBudgetMB <= 0)
+			return;
+		TRACE_SCOPE("TrimFolderSizes");
+
+		struct Candidate {
+			NodeId node;
+			uint32_t viewed;
+			uint32_t depth;
+			uint64_t size;
+		};
+
+		// Still what was saved, so nothing is lost by dropping it
+		auto saved = [&sizes, &scanned](NodeId node, uint64_t size) {
+			auto savedSize = sizes.find(node);
+			if (savedSize == sizes.end() || savedSize->second != size)
+				return false;
+
+			auto scan = FolderScanCache.find(node);
+			auto savedScan = scanned.find(node);
+			if (scan == FolderScanCache.end() || savedScan == scanned.end())
+				return scan == FolderScanCache.end() && savedScan == scanned.end();
+			return scan->second.filesSize == savedScan->second.filesSize && scan->second.last_changed == savedScan->second.last_changed;
+		};
+
+		size_t sizeEntry = HashMapEntryBytes<decltype(FolderSizeCache)>();
+		size_t scanEntry = HashMapEntryBytes<decltype(FolderScanCache)>();
+		size_t viewEntry = HashMapEntryBytes<decltype(FolderSizeViews)>();
+
+		size_t budget = (size_t)folderSizeBudgetMB * 1024 * 1024;
+		size_t excess = 0;
+		std::vector<Candidate> candidates;
+		{
+			std::lock_guard<CountingMutex> lock(resultsMutex);
+			if (FolderSizeCacheBytes() <= budget)
+				return;
+
+			// Measured as if the bucket arrays were already shrunk to fit, as they will be
+			size_t compact = FolderSizeCache.size() * sizeEntry + FolderScanCache.size() * scanEntry + FolderSizeViews.size() * viewEntry;
+			size_t target = budget / 100 * FOLDER_SIZE_TRIM_PERCENT;
+			excess = compact > target ? compact - target : 0;
+
+			candidates.reserve(FolderSizeCache.size());
+			for (const auto& [node, size] : FolderSizeCache)
+			{
+				NodeId parent = Nodes.Parent(node);
+				NodeId grandparent = parent == InvalidNode ? InvalidNode : Nodes.Parent(parent);
+				if (grandparent == InvalidNode || !FolderSizeCache.count(parent) || !FolderSizeCache.count(grandparent))
+					continue;
+				if (!saved(node, size))
+					continue;
+
+				auto view = FolderSizeViews.find(node);
+				candidates.push_back({ node, view == FolderSizeViews.end() ? 0 : view->second, Nodes.Depth(node), size });
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+			if (a.viewed != b.viewed)
+				return a.viewed < b.viewed;
+			if (a.depth != b.depth)
+				return a.depth > b.depth;
+			return a.size < b.size;
+		});
+
+		std::lock_guard<CountingMutex> lock(resultsMutex);
+		size_t before = FolderSizeCacheBytes();
+		size_t freed = 0;
+		uint64_t evicted = 0;
+		for (const Candidate& candidate : candidates)
+		{
+			if (freed >= excess)
+				break;
+
+			// Looked at or rescanned since the candidates were taken
+			auto view = FolderSizeViews.find(candidate.node);
+			if (view != FolderSizeViews.end() && view->second != candidate.viewed)
+				continue;
+			auto it = FolderSizeCache.find(candidate.node);
+			if (it == FolderSizeCache.end() || !saved(candidate.node, it->second))
+				continue;
+
+			freed += sizeEntry;
+			FolderSizeCache.erase(it);
+			if (FolderScanCache.erase(candidate.node))
+				freed += scanEntry;
+			if (view != FolderSizeViews.end())
+			{
+				FolderSizeViews.erase(view);
+				freed += viewEntry;
+			}
+			evicted++;
+		}
+
+		// Erasing keeps the bucket arrays at their old size
+		FolderSizeCache.rehash(0);
+		FolderScanCache.rehash(0);
+		FolderSizeViews.rehash(0);
+		folderSizesEvicted += evicted;
+		if (evicted == 0)
+			return;
+
+		size_t after = FolderSizeCacheBytes();
+		std::cout << "Trimmed " << evicted << " folder sizes (" << FormatFileSize(before - std::min(before, after)) << ") to stay under "
+			<< folderSizeBudgetMB << " MB, now " << FormatFileSize(after) << "\n";
+	}
+
+	// Writes the sizes known so far into the snapshot for the next launch,
+	// then trims the cache to its budget: whatever it drops is in the file.
+	static void SaveFolderSizes()
+	{
+		TRACE_SCOPE("SaveFolderSizes");
+		resultsMutex.lock();
+		std::unordered_map<NodeId, uint64_t> sizes = FolderSizeCache;
+		std::unordered_map<NodeId, FolderScanInfo> scanned = FolderScanCache;
+		resultsMutex.unlock();
+
+		auto start = std::chrono::steady_clock::now();
+		bool saved = FolderSizeSnapshot.Save(Nodes, [&sizes, &scanned](NodeId node, LiveFolder& folder) {
+			auto size = sizes.find(node);
+			if (size != sizes.end())
+			{
+				folder.sizeKnown = true;
+				folder.size = size->second;
+			}
+
+			auto scan = scanned.find(node);
+			if (scan != scanned.end())
+			{
+				folder.scanned = true;
+				folder.filesSize = scan->second.filesSize;
+				folder.last_changed = scan->second.last_changed;
+			}
+		});
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+		if (saved)
+		{
+			std::cout << "Saved " << FolderSizeSnapshot.NodeCount() << " folder sizes in " << elapsed.count() << " ms\n";
+			TrimFolderSizes(sizes, scanned);
+		}
+	}
+
+	// Rebuilds the name index from everything scanned so far. Names under
+	// folders this session hasn't listed are carried over from the old index.
+	// A request made while a build runs isn't dropped: the running build goes
+	// round once more so it picks up whatever was scanned in the meantime.
+	static void BuildNameIndex()
+	{
+		nameIndexRequested = true;
+		if (buildingNameIndex.exchange(true))
+			return;
+
+		while (nameIndexRequested.exchange(false))
+		{
+			TRACE_SCOPE("BuildNameIndex");
+			resultsMutex.lock();
+			std::unordered_map<NodeId, uint64_t> sizes = FolderSizeCache;
+			resultsMutex.unlock();
+
+			bool built = FileNameIndex.Build(Nodes, [&sizes](NodeId node, uint64_t& size) {
+				auto it = sizes.find(node);
+				if (it == sizes.end())
+					return false;
+				size = it->second;
+				return true;
+			});
+
+			if (built)
+				std::cout << "Indexed " << FileNameIndex.EntryCount() << " names (" << FileNameIndex.TrigramCount() << " trigrams, "
+					<< FileNameIndex.FileSize() / (1024 * 1024) << " MB) in " << (int)FileNameIndex.BuildMilliseconds() << " ms\n";
+		}
+		buildingNameIndex = false;
+		NotifyModelChanged();
+
+		// Asked for between the last check and clearing the flag
+		if (nameIndexRequested)
+			BuildNameIndex();
+	}
+
+	// Adds `delta` to the total of `folder` and of every ancestor that has one.
+	// Expects resultsMutex to be held.
+	static void PatchFolderSizes(NodeId folder, int64_t delta)
+	{
+		for (NodeId node = folder; node != InvalidNode; node = Nodes.Parent(node))
+		{
+			// A trimmed total is read back so it doesn't go stale in the snapshot
+			uint64_t size = 0;
+			if (!FindFolderSize(node, size))
+				continue;
+
+			size += (uint64_t)delta;
+			FolderSizeCache[node] = size;
+			Nodes.SetSize(node, size);
+		}
+	}
+
+	// Drops the totals of `folder` and its ancestors, once something below
+	// them can't be sized. Expects resultsMutex to be held.
+	static void ForgetFolderSizes(NodeId folder)
+	{
+		for (NodeId node = folder; node != InvalidNode; node = Nodes.Parent(node))
+		{
+			FolderSizeCache.erase(node);
+			FolderScanCache.erase(node);
+			FolderSizeViews.erase(node);
+		}
+	}
+
+	// Re-reads one folder the watcher reported and patches what is cached
+	// about it: its listing in the node table, its own share of its total and
+	// the totals of its ancestors. Only sub folders that are new get scanned.
+	static void RefreshDirectory(NodeId directory)
+	{
+		TRACE_SCOPE("RefreshDirectory");
+		static thread_local DirListing listing;
+		static thread_local std::vector<NodeId> ids;
+
+		std::vector<NodeId> oldFolders;
+		Nodes.ForEachChild(directory, [&oldFolders](NodeId child) {
+			if (Nodes.Get(child).kind == EntryKind::Folder)
+				oldFolders.push_back(child);
+		});
+
+		std::string path = Nodes.Path(directory);
+		uint64_t last_changed = 0;
+		GetLastChanged(path, last_changed);
+		ReadDirectory(path, EnumFlags_All, listing, ids, true);
+
+		uint64_t filesSize = 0;
+		std::vector<NodeId> folders;
+		for (size_t i = 0; i < listing.Size(); i++)
+		{
+			if (listing.entries[i].kind == EntryKind::Folder)
+				folders.push_back(ids[i]);
+			else
+				filesSize += listing.entries[i].size;
+		}
+
+		// Ids survive a re-read, so the difference is what was added or removed
+		std::sort(oldFolders.begin(), oldFolders.end());
+		std::sort(folders.begin(), folders.end());
+		std::vector<NodeId> added, removed;
+		std::set_difference(folders.begin(), folders.end(), oldFolders.begin(), oldFolders.end(), std::back_inserter(added));
+		std::set_difference(oldFolders.begin(), oldFolders.end(), folders.begin(), folders.end(), std::back_inserter(removed));
+
+		if (directory == listedDirectory)
+		{
+			refreshListing = true;
+			NotifyModelChanged();
+		}
+
+		std::lock_guard<CountingMutex> lock(resultsMutex);
+		uint64_t oldTotal = 0;
+		if (!FindFolderSize(directory, oldTotal))
+			return; // no size to keep current
+
+		auto scanned = FolderScanCache.find(directory);
+		bool exact = scanned != FolderScanCache.end();
+		int64_t delta = exact ? (int64_t)(filesSize - scanned->second.filesSize) : 0;
+		for (NodeId folder : removed)
+		{
+			auto it = FolderSizeCache.find(folder);
+			exact = exact && it != FolderSizeCache.end();
+			if (it != FolderSizeCache.end())
+			{
+				delta -= (int64_t)it->second;
+				FolderSizeCache.erase(it);
+				FolderSizeViews.erase(folder);
+			}
+		}
+
+		if (!exact)
+		{
+			// Not enough is known to patch it, so size this one folder again
+			NodeId parent = Nodes.Parent(directory);
+			StartFolderScan(directory, [directory, parent, oldTotal]() {
+				std::lock_guard<CountingMutex> lock(resultsMutex);
+				auto it = FolderSizeCache.find(directory);
+				if (it != FolderSizeCache.end())
+					PatchFolderSizes(parent, (int64_t)(it->second - oldTotal));
+				else
+					ForgetFolderSizes(parent);
+			});
+			return;
+		}
+
+		PatchFolderSizes(directory, delta);
+		FolderScanCache[directory] = { filesSize, last_changed };
+		NotifyModelChanged();
+
+		for (NodeId folder : added)
+		{
+			StartFolderScan(folder, [folder]() {
+				std::lock_guard<CountingMutex> lock(resultsMutex);
+				auto it = FolderSizeCache.find(folder);
+				if (it != FolderSizeCache.end())
+					PatchFolderSizes(Nodes.Parent(folder), (int64_t)it->second);
+				else
+					ForgetFolderSizes(Nodes.Parent(folder));
+			});
+		}
+	}
+
+	// Watcher callback with the folders that changed since the last batch.
+	static void OnFolderChanges(const std::vector<std::string>& directories, bool overflow)
+	{
+		for (const auto& directory : directories)
+		{
+			// Folders never read have nothing cached that could go stale
+			NodeId node = Nodes.Find(directory);
+			if (node != InvalidNode && Nodes.Listed(node))
+				RefreshDirectory(node);
+		}
+
+		if (overflow)
+		{
+			// Changes were lost; the snapshot makes a re-check of every folder
+			// cheap. Like any incremental scan it only sees folders whose mtime
+			// moved, which covers created, deleted and renamed entries.
+			std::cout << "Change notifications overflowed, revalidating folder sizes\n";
+			refreshListing = true;
+			NotifyModelChanged();
+			if (FolderSizeSnapshot.Loaded() && activeScans == 0)
+			{
+				for (NodeId root : Nodes.Roots())
+				{
+					resultsMutex.lock();
+					bool sized = FolderSizeCache.count(root) != 0;
+					resultsMutex.unlock();
+					if (sized)
+						StartFolderScan(root, SaveFolderSizes, true);
+				}
+			}
+		}
+	}
+
+	// The calling thread's heap in a WorkerTopK.
+	template<typename T>
+	static size_t RankSlot(const WorkerTopK<T>& ranking)
+	{
+		return ranking.SlotFor(ScanPool.IsWorkerThread() ? ScanPool.WorkerIndex() : SIZE_MAX);
+	}
+
+	// Ranks a matching folder. If its size isn't known yet (and the setting
+	// asks for it) a scan is started, and the merge picks the size up later.
+	static void AddFolderResult(const std::shared_ptr<SearchJob>& job, const FolderInfo& folder, uint32_t depth, int score)
+	{
+		bool scan = false;
+		uint64_t folderSize = 0;
+		{
+			TRACE_SCOPE("FolderSizeLookup");
+			std::lock_guard<CountingMutex> lock(resultsMutex);
+			if (!FindFolderSize(folder.node, folderSize))
+				scan = getFolderSizeOnSearch;
+		}
+
+		job->ranking.Offer(RankSlot(job->ranking), score, [&]() {
+			SearchResult result{ .node = folder.node, .last_changed = folder.last_changed, .type = "", .size = folderSize, .depth = depth, .score = score };
+			FillResultText(result);
+			return result;
+		});
+
+		if (scan)
+		{
+			job->sizeScans->Add();
+			StartFolderScan(folder.node, [job]() {
+				job->ranking.Touch();
+				job->sizeScans->Done();
+			});
+		}
+	}
+
+	// Reads one directory: matching files go straight into the results, and
+	// only sub folders are kept around for the next level.
+	static std::vector<FolderInfo> SearchDirectory(const std::shared_ptr<SearchJob>& job, NodeId directory, uint32_t depth)
+	{
+		TRACE_SCOPE("SearchDirectory");
+		const SearchQuery& query = job->query;
+		std::vector<FolderInfo> folders;
+
+		static thread_local DirListing listing;
+		static thread_local std::vector<NodeId> ids;
+		std::string path = Nodes.Path(directory);
+
+		// Stat every entry only for the filters that need it; a match gets
+		// its size and date on its own below.
+		ReadDirectory(path, query.EnumFlags(), listing, ids, false);
+
+		// The path filter holds for the whole folder, so check it once
+		bool pathMatches = query.MatchesDirectory(path);
+
+		uint64_t directoryBytes = 0;
+		for (size_t i = 0; i < listing.Size() && !cancelSearch; i++)
+		{
+			DirEntry entry = listing.entries[i];
+			std::string_view name = listing.Name(i);
+			auto completeEntry = [&]() {
+				if (listing.flags != EnumFlags_All)
+					GetFileInfo(JoinPath(path, name.data(), name.size()), entry.size, entry.last_changed);
+			};
+
+			// Results are found again by node, so nothing the table can't hold
+			if (entry.kind == EntryKind::Folder)
+			{
+				if (ids[i] == InvalidNode)
+					continue;
+				FolderInfo& folder = folders.emplace_back();
+				folder.node = ids[i];
+				folder.name = name;
+
+				if (pathMatches)
+				{
+					uint64_t folderSize = 0;
+					bool sizeKnown = false;
+					if (query.HasSize())
+					{
+						std::lock_guard<CountingMutex> lock(resultsMutex);
+						sizeKnown = FindFolderSize(folder.node, folderSize);
+					}
+
+					int nameScore;
+					if (query.MatchesEntry(EntryKind::Folder, name, folderSize, sizeKnown, entry.last_changed, nameScore))
+					{
+						completeEntry();
+						folder.last_changed = ToFileTime(entry.last_changed);
+						AddFolderResult(job, folder, depth, query.Score(nameScore, depth, entry.last_changed, job->now));
+					}
+				}
+				continue;
+			}
+
+			directoryBytes += entry.size;
+			int nameScore;
+			if (pathMatches && ids[i] != InvalidNode && query.MatchesEntry(EntryKind::File, name, entry.size, true, entry.last_changed, nameScore))
+			{
+				completeEntry();
+				int score = query.Score(nameScore, depth, entry.last_changed, job->now);
+				job->ranking.Offer(RankSlot(job->ranking), score, [&]() {
+					SearchResult result{ .node = ids[i], .last_changed = ToFileTime(entry.last_changed), .type = ExtractFileType(std::string(name)), .size = entry.size, .depth = depth, .score = score };
+					FillResultText(result);
+					return result;
+				});
+			}
+		}
+		bytesRead += directoryBytes;
+
+		return folders;
+	}
+
+	// A directory to search, the depth of the entries inside it and how many
+	// folder levels below it are still searched. Depth counts from the
+	// filesystem root, like the name index's, so both score a path the same.
+	struct SearchItem {
+		NodeId directory;
+		uint32_t depth;
+		int levels;
+	};
+
+	static void SearchFiles(const std::shared_ptr<TaskGroup>& group, const std::shared_ptr<SearchJob>& job, const std::vector<SearchItem>& directories)
+	{
+		TRACE_SCOPE("SearchFiles");
+		std::vector<SearchItem> subFolders;
+
+		for (const SearchItem& item : directories)
+		{
+			if (cancelSearch) return;
+			if (item.directory == InvalidNode) continue;
+
+			auto folders = SearchDirectory(job, item.directory, item.depth);
+			for (const auto& folder : folders)
+			{
+				if (item.levels > 0)
+					subFolders.push_back({ folder.node, item.depth + 1, item.levels - 1 });
+			}
+		}
+
+		SubmitChunked(group, subFolders, [job](const std::shared_ptr<TaskGroup>& group, const std::vector<SearchItem>& batch) {
+			SearchFiles(group, job, batch);
+		});
+	}
+
+	static std::shared_ptr<TaskGroup> StartGetFileSize(const std::string& path)
+	{
+		currentPropertiesSize = 0;
+		currentPropertiesFolderCount = 0;
+		currentPropertiesFileCount = 0;
+		Telemetry.Reset(ScanPool);
+
+		return StartFolderScan(Nodes.Intern(path));
+		//currentPropertiesSize += GetFileSize(path);
+	}
+
+	// Runs when a storage scan finishes: report how much of it was skipped and
+	// keep the result for the next (incremental) scan.
+	static void FinishStorageScan()
+	{
+		std::cout << "Storage scan done in " << elapsedScanTime.load().count() << " ms: " << scanRevalidatedCount << " folders revalidated, "
+			<< scanRereadCount << " read\n";
+		// The index copies sizes from the cache, so it goes before the save trims it
+		BuildNameIndex();
+		SaveFolderSizes();
+	}
+
+	static void ResetScanCounters()
+	{
+		currentPropertiesSize = 0;
+		currentPropertiesFolderCount = 0;
+		currentPropertiesFileCount = 0;
+		scanRevalidatedCount = 0;
+		scanRereadCount = 0;
+		Telemetry.Reset(ScanPool);
+	}
+
+	static std::shared_ptr<TaskGroup> StartStorageScan(const std::string& root)
+	{
+		startScanTime = std::chrono::steady_clock::now();
+		ResetScanCounters();
+
+		return StartFolderScan(Nodes.Intern(root), FinishStorageScan, incrementalScan);
+	}
+
+	// Scans every root at once and finishes (report, index, save) once, after
+	// the last of them is done.
+	static void StartFullStorageScan()
+	{
+		startScanTime = std::chrono::steady_clock::now();
+		ResetScanCounters();
+
+		std::vector<NodeId> roots;
+		for (const auto& root : storageRoots)
+		{
+			NodeId node = Nodes.Intern(root);
+			if (node != InvalidNode)
+				roots.push_back(node);
+		}
+
+		if (roots.empty())
+		{
+			// Nothing to scan: finish at once, on the pool like a scan would
+			elapsedScanTime = std::chrono::milliseconds(0);
+			activeScans++;
+			auto group = std::make_shared<TaskGroup>([]() {
+				activeScans--;
+				NotifyModelChanged();
+			});
+			ScanPool.Submit(group, FinishStorageScan);
+			return;
+		}
+
+		auto remaining = std::make_shared<std::atomic<size_t>>(roots.size());
+		for (NodeId root : roots)
+		{
+			StartFolderScan(root, [remaining]() {
+				if (remaining->fetch_sub(1) == 1)
+					FinishStorageScan();
+			}, incrementalScan);
+		}
+	}
+
+	// Answers a search from the name index. The filter ranks every entry
+	// that matches instead of stopping at the first MAX_RESULTS, and only the
+	// best are interned so they can point at nodes like SearchFiles' results.
+	static void SearchNameIndex(const std::shared_ptr<SearchJob>& job)
+	{
+		TRACE_SCOPE("SearchNameIndex");
+		const SearchQuery& query = job->query;
+		WorkerTopK<uint32_t> ranked(ScanPool.WorkerCount(), MAX_RESULTS);
+
+		// The longest name term picks the candidates, the rest of the query filters them
+		auto filter = [&](const NameIndexEntry& entry, std::string_view name, uint32_t index) {
+			int nameScore;
+			if (cancelSearch || !query.MatchesEntry(entry.kind, name, entry.size, true, entry.last_changed, nameScore)
+				|| !FileNameIndex.EntryWithin(index, job->indexFolders, job->levels))
+				return false;
+
+			if (query.HasPathTerms())
+			{
+				static thread_local std::string directory;
+				FileNameIndex.EntryDirectory(index, directory);
+				if (!query.MatchesDirectory(directory))
+					return false;
+			}
+
+			ranked.Push(RankSlot(ranked), query.Score(nameScore, FileNameIndex.EntryDepth(index), entry.last_changed, job->now), index);
+			return false; // the ranking keeps it
+		};
+
+		// Short and fuzzy queries sweep every name, so let the whole pool help
+		FileNameIndex.Query(query.LongestNameTerm(), SIZE_MAX, [](size_t count, const std::function<void(size_t)>& fn) {
+			ScanPool.ParallelFor(count, fn);
+		}, filter);
+
+		ranked.Drain();
+		std::vector<std::pair<int, uint32_t>> best = ranked.Best();
+		std::vector<uint32_t> indices;
+		for (const auto& [score, index] : best)
+			indices.push_back(index);
+		std::vector<NameIndexMatch> matches = FileNameIndex.Matches(indices);
+
+		size_t slot = RankSlot(job->ranking);
+		for (size_t i = 0; i < matches.size() && !cancelSearch; i++)
+		{
+			const NameIndexMatch& match = matches[i];
+			NodeId parent = Nodes.Intern(match.directory);
+			NodeId node = parent != InvalidNode ? Nodes.FindOrAddChild(parent, match.name, match.kind) : Nodes.Intern(match.name);
+			if (node == InvalidNode)
+				continue;
+
+			std::string type = match.kind == EntryKind::File ? ExtractFileType(match.name) : "";
+			int score = best[i].first;
+			SearchResult result{ .node = node, .last_changed = ToFileTime(match.last_changed), .type = std::move(type), .size = match.size, .depth = match.depth, .score = score };
+			FillResultText(result);
+			job->ranking.Push(slot, score, std::move(result));
+		}
+
+		std::cout << "Name index: ranked " << ranked.Matches() << " matches from " << FileNameIndex.LastCandidateCount() << " candidates in "
+			<< FileNameIndex.LastQueryMilliseconds() << " ms\n";
+	}
+
+	static int CompareNoCase(std::string_view a, std::string_view b)
+	{
+		size_t length = std::min(a.size(), b.size());
+		for (size_t i = 0; i < length; i++)
+		{
+			int ca = (unsigned char)FoldChar(a[i]);
+			int cb = (unsigned char)FoldChar(b[i]);
+			if (ca != cb)
+				return ca - cb;
+		}
+		return (int)a.size() - (int)b.size();
+	}
+
+	// Order of two results under the table's current sort; equal keys fall
+	// back to arrival order so a merge and a full sort agree.
+	static bool ResultLess(const SearchResult& a, const SearchResult& b)
+	{
+		int order = 0;
+		switch (resultSortColumn)
+		{
+		case 0: order = ComparePathsNoCase(a.node, b.node); break;
+		case 1:
+		{
+			uint64_t changedA = FileTimeKey(a.last_changed), changedB = FileTimeKey(b.last_changed);
+			order = changedA < changedB ? -1 : changedA > changedB ? 1 : 0;
+			break;
+		}
+		case 2: order = CompareNoCase(a.type, b.type); break;
+		case 3: order = a.size < b.size ? -1 : a.size > b.size ? 1 : 0; break;
+		case 4: order = (int)a.depth - (int)b.depth; break;
+		case 5: order = a.score - b.score; break;
+		}
+		if (order != 0)
+			return resultSortAscending ? order < 0 : order > 0;
+		return a.id < b.id;
+	}
+
+	// A full sort of results2 by the table's sort, from keys taken once per
+	// row: arrival order first, then a stable radix sort (or multikey
+	// quicksort for paths) on the column, which gives ResultLess's order.
+	static void SortResults()
+	{
+		TRACE_SCOPE("SortResults");
+		SortRowsByKey(results2, true, [](const SearchResult& result) { return result.id; });
+
+		switch (resultSortColumn)
+		{
+		case 0:
+		{
+			std::vector<std::string> paths(results2.size());
+			std::vector<StringItem> items;
+			items.reserve(results2.size());
+			for (size_t i = 0; i < results2.size(); i++)
+			{
+				Nodes.BuildPath(results2[i].node, paths[i]);
+				for (char& c : paths[i])
+					c = FoldChar(c);
+				items.push_back({ paths[i], (uint32_t)i });
+			}
+			MultikeyQuicksort(items, !resultSortAscending);
+			ApplyOrder(results2, items);
+			break;
+		}
+		case 1:
+			SortRowsByKey(results2, resultSortAscending, [](const SearchResult& result) { return FileTimeKey(result.last_changed); });
+			break;
+		case 2:
+		{
+			std::vector<std::string_view> types;
+			types.reserve(results2.size());
+			for (const SearchResult& result : results2)
+				types.push_back(result.type);
+			std::vector<uint32_t> extensions = RankFolded(types);
+			std::vector<RadixItem> items;
+			items.reserve(results2.size());
+			for (size_t i = 0; i < results2.size(); i++)
+				items.push_back({ resultSortAscending ? extensions[i] : ~(uint64_t)extensions[i], (uint32_t)i });
+			RadixSort(items);
+			ApplyOrder(results2, items);
+			break;
+		}
+		case 3:
+			SortRowsByKey(results2, resultSortAscending, [](const SearchResult& result) { return result.size; });
+			break;
+		case 4:
+			SortRowsByKey(results2, resultSortAscending, [](const SearchResult& result) { return (uint64_t)result.depth; });
+			break;
+		case 5:
+			SortRowsByKey(results2, resultSortAscending, [](const SearchResult& result) { return SignedKey(result.score); });
+			break;
+		}
+	}
+
+	// Folds the ranking's changes since the last frame into results2 without
+	// re-sorting it: rows that fell out of the top results are dropped, the
+	// new ones (and folders whose size changed, when sorting by size) are
+	// sorted on their own and merged in. UI thread only.
+	static void MergeSearchResults()
+	{
+		TRACE_SCOPE("MergeSearchResults");
+		auto start = std::chrono::steady_clock::now();
+		WorkerTopK<SearchResult>::Delta delta;
+		if (!searchJob || !searchJob->ranking.Drain(&delta))
+			return;
+
+		std::vector<SearchResult> batch;
+		for (auto& [id, item] : delta.added)
+		{
+			item.second.id = id;
+			batch.push_back(std::move(item.second));
+		}
+
+		std::sort(delta.evicted.begin(), delta.evicted.end());
+		auto evicted = [&delta](const SearchResult& result) {
+			return std::binary_search(delta.evicted.begin(), delta.evicted.end(), result.id);
+		};
+		std::erase_if(results2, evicted);
+		std::erase_if(batch, evicted);
+
+		// Folder sizes scans have filled in since they were ranked
+		auto refreshSize = [](SearchResult& result) {
+			if (!result.type.empty())
+				return false;
+			auto it = FolderSizeCache.find(result.node);
+			if (it == FolderSizeCache.end() || it->second == result.size)
+				return false;
+			result.size = it->second;
+			FormatSize(result.size, result.sizeText);
+			return true;
+		};
+		{
+			std::lock_guard<CountingMutex> lock(resultsMutex);
+			for (SearchResult& result : batch)
+				refreshSize(result);
+
+			size_t kept = 0;
+			for (size_t i = 0; i < results2.size(); i++)
+			{
+				// A row whose sort key moved has to be placed again
+				if (refreshSize(results2[i]) && resultSortColumn == 3)
+					batch.push_back(std::move(results2[i]));
+				else
+				{
+					if (kept != i)
+						results2[kept] = std::move(results2[i]);
+					kept++;
+				}
+			}
+			results2.resize(kept);
+		}
+
+		if (resortResults)
+			results2.insert(results2.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+		else
+		{
+			std::sort(batch.begin(), batch.end(), ResultLess);
+			size_t middle = results2.size();
+			results2.insert(results2.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+			std::inplace_merge(results2.begin(), results2.begin() + middle, results2.end(), ResultLess);
+		}
+
+		lastMergeMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		maxMergeMicroseconds = std::max(maxMergeMicroseconds, lastMergeMicroseconds);
+	}
+
+	bool Search(std::string text) {
+		std::cout << "Starting search...\n";
+
+		SearchQuery compiled;
+		searchError.clear();
+		if (!compiled.Compile(text, searchError, fuzzySearch))
+		{
+			// Nothing started, so isSearching stays with whichever search is
+			// running; its onDone clears it.
+			std::cerr << searchError << "\n";
+			return false;
+		}
+		auto job = std::make_shared<SearchJob>(std::move(compiled), ScanPool.WorkerCount());
+
+		resultsMutex.lock();
+		results2.clear();
+		resultsMutex.unlock();
+
+		bytesRead = 0;
+
+		uint64_t generation;
+		{
+			std::lock_guard<std::mutex> lock(searchStateMutex);
+			generation = ++searchGeneration;
+			isSearching = true;
+		}
+		// Runs once every search task is done
+		auto onDone = [job, generation]() {
+			{
+				std::lock_guard<std::mutex> lock(searchStateMutex);
+				if (generation == searchGeneration)
+					isSearching = false;
+			}
+			job->sizeScans->Done();
+			NotifyModelChanged();
+		};
+
+		showingResults = true;
+		searchJob = job;
+		lastMergeMicroseconds = 0.0;
+		maxMergeMicroseconds = 0.0;
+		resultsMutex.ResetCounters();
+		Telemetry.Reset(ScanPool);
+
+		// Roots the name index has listed are answered from it, the rest
+		// from the disk. Both look at most searchDepthMax levels down.
+		job->levels = std::max(1, searchDepthMax);
+		std::vector<SearchItem> roots;
+		for (const auto& root : storageRoots)
+		{
+			uint32_t folder = useNameIndex ? FileNameIndex.FindListedFolder(root) : InvalidSnapshotIndex;
+			if (folder != InvalidSnapshotIndex)
+			{
+				job->indexFolders.push_back(folder);
+				continue;
+			}
+
+			std::cout << "Scanning drive " << root << "\n";
+			NodeId node = Nodes.Intern(root);
+			if (node != InvalidNode)
+				roots.push_back({ node, Nodes.Depth(node) + 1, searchDepthMax - 1 });
+		}
+
+		searchGroup = std::make_shared<TaskGroup>(onDone);
+		if (!job->indexFolders.empty())
+			ScanPool.Submit(searchGroup, [job]() { SearchNameIndex(job); });
+		SubmitChunked(searchGroup, roots, [job](const std::shared_ptr<TaskGroup>& group, const std::vector<SearchItem>& batch) {
+			SearchFiles(group, job, batch);
+		});
+		if (roots.empty() && job->indexFolders.empty())
+		{
+			// Nothing to submit; finish the group so onDone still runs
+			searchGroup->Add();
+			searchGroup->Done();
+		}
+
+		return true;
+	}
+
+	// Heap bytes a row holds beyond its own slot in the vector
+	static size_t RowHeapBytes(const FileInfo& file)
+	{
+		return StringHeapBytes(file.name) + StringHeapBytes(file.type) + StringHeapBytes(file.foldedName);
+	}
+
+	static size_t RowHeapBytes(const FolderInfo& folder)
+	{
+		return StringHeapBytes(folder.name) + StringHeapBytes(folder.foldedName);
+	}
+
+	static size_t RowHeapBytes(const SearchResult& result)
+	{
+		return StringHeapBytes(result.type) + StringHeapBytes(result.path);
+	}
+
+	template<typename Row>
+	static size_t RowsHeapBytes(const std::vector<Row>& rows)
+	{
+		size_t bytes = VectorHeapBytes(rows);
+		for (const Row& row : rows)
+			bytes += RowHeapBytes(row);
+		return bytes;
+	}
+
+	// What the engine's growing structures hold. Reads results2, so only the
+	// thread that owns it may call this.
+	static MemoryReport EngineMemory()
+	{
+		MemoryReport report;
+		report.folderSizeBudget = folderSizeBudgetMB > 0 ? (size_t)folderSizeBudgetMB * 1024 * 1024 : 0;
+		report.evicted = folderSizesEvicted;
+		{
+			std::lock_guard<CountingMutex> lock(resultsMutex);
+			report.structures.push_back({ "folder_sizes", "Folder sizes", FolderSizeCache.size(), HashMapHeapBytes(FolderSizeCache) });
+			report.structures.push_back({ "folder_scans", "Folder scan info", FolderScanCache.size(), HashMapHeapBytes(FolderScanCache) });
+			report.structures.push_back({ "folder_views", "Folder view times", FolderSizeViews.size(), HashMapHeapBytes(FolderSizeViews) });
+			report.folderSizeBytes = FolderSizeCacheBytes();
+		}
+		report.structures.push_back({ "nodes", "Node table", Nodes.Count(), Nodes.MemoryUsage() });
+		report.structures.push_back({ "results", "Search results", results2.size(), RowsHeapBytes(results2) });
+		return report;
+	}
+
+	// Applies a new worker count; only while nothing is running on the pool.
+	static bool RestartScanPool()
+	{
+		if (activeScans > 0 || isSearching)
+			return false;
+
+		ScanPool.Stop();
+		ScanPool.Start((unsigned)std::max(0, scanWorkerCount));
+		return true;
+	}
+
+	static std::string StatePath(const char* file)
+	{
+		return stateDirectory.empty() ? std::string(file) : JoinPath(stateDirectory, file, strlen(file));
+	}
+
+	// Starts the engine: the scan pool, the change watcher, and the folder
+	// sizes and name index saved by earlier sessions.
+	static void InitEngine()
+	{
+		ScanPool.Start((unsigned)scanWorkerCount);
+
+		if (watchChanges)
+			Watcher.Start(OnFolderChanges);
+
+		if (FolderSizeSnapshot.Load(StatePath(SNAPSHOT_FILE)))
+		{
+			std::cout << "Loaded " << FolderSizeSnapshot.NodeCount() << " folder sizes (" << FormatFileSize(FolderSizeSnapshot.FileSize())
+				<< ") mapped in " << FolderSizeSnapshot.MapMilliseconds() << " ms, verified in " << FolderSizeSnapshot.VerifyMilliseconds() << " ms\n";
+		}
+
+		if (FileNameIndex.Load(StatePath(NAME_INDEX_FILE)))
+		{
+			std::cout << "Loaded name index: " << FileNameIndex.EntryCount() << " names (" << FormatFileSize(FileNameIndex.FileSize())
+				<< ") in " << FileNameIndex.LoadMilliseconds() << " ms\n";
+		}
+	}
+
+}
\ No newline at end of file
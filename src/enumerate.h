@@ -0,0 +1,601 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+#endif
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+#define GETDENTS_BUFFER_SIZE (256 * 1024)
+#define ENUM_BATCH_SIZE 256
+#define ENUM_BATCH_NAMES_SIZE (64 * 1024)
+#define FILETIME_UNIX_EPOCH 116444736000000000ULL
+
+namespace File {
+
+	enum class EntryKind : uint8_t {
+		File,
+		Folder
+	};
+
+	// Metadata a caller wants on top of name and kind. The native backends
+	// only issue a stat for an entry when one of these is requested.
+	enum EnumFlags : uint32_t {
+		EnumFlags_None = 0,
+		EnumFlags_Size = 1 << 0,
+		EnumFlags_Time = 1 << 1,
+		EnumFlags_All = EnumFlags_Size | EnumFlags_Time
+	};
+
+	// What a listing carries whether asked or not: FindFirstFile returns size
+	// and time with every name.
+#ifdef _WIN32
+	constexpr uint32_t EnumFlags_Free = EnumFlags_All;
+#else
+	constexpr uint32_t EnumFlags_Free = EnumFlags_None;
+#endif
+
+	enum class EnumBackend {
+		Native, // FindFirstFileExW on Windows, getdents64 on Linux
+		Std,    // std::filesystem::directory_iterator
+		IoUring // getdents64 plus batched io_uring statx on Linux, Native elsewhere
+	};
+
+	EnumBackend enumBackend = EnumBackend::Native;
+
+	// One directory entry. `name` points into the reader and is only valid until
+	// the next call to Next(). Times are FILETIME ticks (100ns since 1601) on
+	// every platform so the rest of the code doesn't care where they came from.
+	struct DirEntry {
+		const char* name = nullptr;
+		uint32_t nameLength = 0;
+		EntryKind kind = EntryKind::File;
+		uint64_t size = 0;
+		uint64_t last_changed = 0;
+
+		std::string_view Name() const { return std::string_view(name, nameLength); }
+	};
+
+	static std::string JoinPath(const std::string& directoryPath, const char* name, size_t nameLength)
+	{
+		std::string path;
+		path.reserve(directoryPath.size() + nameLength + 1);
+		path = directoryPath;
+		if (!path.empty() && path.back() != PATH_SEPARATOR)
+			path.push_back(PATH_SEPARATOR);
+		path.append(name, nameLength);
+		return path;
+	}
+
+	static std::string JoinPath(const std::string& directoryPath, const std::string& name)
+	{
+		return JoinPath(directoryPath, name.data(), name.size());
+	}
+
+	// System calls the enumeration code has made on this thread. Telemetry
+	// takes the difference around each directory it reads.
+	static thread_local uint64_t enumSyscalls = 0;
+
+	static bool IsDotEntry(const char* name)
+	{
+		return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+	}
+
+#ifndef _WIN32
+	static uint64_t TimespecToFileTime(const struct timespec& ts)
+	{
+		return (uint64_t)ts.tv_sec * 10000000ULL + (uint64_t)ts.tv_nsec / 100 + FILETIME_UNIX_EPOCH;
+	}
+
+	// getdents64 buffers are large, so keep a few per thread instead of
+	// allocating one for every directory.
+	static thread_local std::vector<std::unique_ptr<char[]>> getdentsBuffers;
+
+	static std::unique_ptr<char[]> AcquireGetdentsBuffer()
+	{
+		if (getdentsBuffers.empty())
+			return std::make_unique<char[]>(GETDENTS_BUFFER_SIZE);
+
+		auto buffer = std::move(getdentsBuffers.back());
+		getdentsBuffers.pop_back();
+		return buffer;
+	}
+
+	static void ReleaseGetdentsBuffer(std::unique_ptr<char[]> buffer)
+	{
+		if (buffer && getdentsBuffers.size() < 4)
+			getdentsBuffers.push_back(std::move(buffer));
+	}
+
+	struct linux_dirent64 {
+		ino64_t d_ino;
+		off64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[];
+	};
+#endif
+
+	// Reads one directory through the selected backend.
+	class DirReader {
+	public:
+		DirReader() = default;
+		DirReader(const DirReader&) = delete;
+		DirReader& operator=(const DirReader&) = delete;
+
+		~DirReader() { Close(); }
+
+		bool Open(const std::string& directoryPath, uint32_t flags = EnumFlags_All, EnumBackend backend = enumBackend)
+		{
+			Close();
+			m_Flags = flags;
+			m_Backend = backend;
+
+			// Without a working ring io_uring is just the native backend
+#ifdef _WIN32
+			if (m_Backend == EnumBackend::IoUring)
+				m_Backend = EnumBackend::Native;
+#else
+			if (m_Backend == EnumBackend::IoUring && !IoUringAvailable())
+				m_Backend = EnumBackend::Native;
+#endif
+
+			if (m_Backend == EnumBackend::Std)
+			{
+				m_Iterator = std::filesystem::directory_iterator(directoryPath, std::filesystem::directory_options::skip_permission_denied, m_Error);
+				return !m_Error;
+			}
+
+#ifdef _WIN32
+			std::string searchPath = directoryPath;
+			if (searchPath.empty() || searchPath.back() != PATH_SEPARATOR)
+				searchPath.push_back(PATH_SEPARATOR);
+			searchPath.push_back('*');
+
+			// Paths in the rest of the app are in the ANSI code page (they came
+			// from the A functions before), so convert with CP_ACP both ways.
+			int length = MultiByteToWideChar(CP_ACP, 0, searchPath.c_str(), -1, nullptr, 0);
+			if (length == 0)
+				return false;
+			std::wstring wideSearchPath(length - 1, L'\0');
+			MultiByteToWideChar(CP_ACP, 0, searchPath.c_str(), -1, &wideSearchPath[0], length);
+
+			m_Find = FindFirstFileExW(wideSearchPath.c_str(), FindExInfoBasic, &m_FindData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+			enumSyscalls++;
+			if (m_Find == INVALID_HANDLE_VALUE)
+			{
+				m_Error = std::error_code((int)GetLastError(), std::system_category());
+				return false;
+			}
+			m_HasPending = true;
+			return true;
+#else
+			m_Fd = open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			enumSyscalls++;
+			if (m_Fd < 0)
+			{
+				m_Error = std::error_code(errno, std::generic_category());
+				return false;
+			}
+			m_Buffer = AcquireGetdentsBuffer();
+			m_BufferPos = m_BufferEnd = 0;
+			m_StatPos = m_StatCount = 0;
+			return true;
+#endif
+		}
+
+		bool Next(DirEntry& entry)
+		{
+			if (m_Backend == EnumBackend::Std)
+				return NextStd(entry);
+#ifdef _WIN32
+			return NextWin32(entry);
+#else
+			return NextGetdents(entry);
+#endif
+		}
+
+		void Close()
+		{
+			m_Iterator = std::filesystem::directory_iterator();
+#ifdef _WIN32
+			if (m_Find != INVALID_HANDLE_VALUE)
+			{
+				FindClose(m_Find);
+				enumSyscalls++;
+				m_Find = INVALID_HANDLE_VALUE;
+			}
+			m_HasPending = false;
+#else
+			if (m_Fd >= 0)
+			{
+				close(m_Fd);
+				enumSyscalls++;
+				m_Fd = -1;
+			}
+			ReleaseGetdentsBuffer(std::move(m_Buffer));
+#endif
+		}
+
+		// Set when Open() or a stat failed; entries that can't be stat'ed are still returned.
+		const std::error_code& Error() const { return m_Error; }
+
+	private:
+		bool NextStd(DirEntry& entry)
+		{
+			namespace fs = std::filesystem;
+
+			while (m_Iterator != fs::directory_iterator())
+			{
+				const fs::directory_entry& dirEntry = *m_Iterator;
+				m_StdName = dirEntry.path().filename().string();
+
+				std::error_code ec;
+				entry.name = m_StdName.c_str();
+				entry.nameLength = (uint32_t)m_StdName.size();
+				entry.kind = dirEntry.is_directory(ec) ? EntryKind::Folder : EntryKind::File;
+				entry.size = 0;
+				entry.last_changed = 0;
+
+				if ((m_Flags & EnumFlags_Size) && entry.kind == EntryKind::File)
+				{
+					uintmax_t size = dirEntry.file_size(ec);
+					entry.size = ec ? 0 : (uint64_t)size;
+				}
+
+				if (m_Flags & EnumFlags_Time)
+				{
+					auto time = dirEntry.last_write_time(ec);
+					if (!ec)
+					{
+						using FileTimeTicks = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+#ifdef _WIN32
+						// MSVC's file_clock already counts 100ns ticks from 1601
+						entry.last_changed = (uint64_t)std::chrono::duration_cast<FileTimeTicks>(time.time_since_epoch()).count();
+#else
+						auto sinceEpoch = std::chrono::file_clock::to_sys(time).time_since_epoch();
+						entry.last_changed = (uint64_t)std::chrono::duration_cast<FileTimeTicks>(sinceEpoch).count() + FILETIME_UNIX_EPOCH;
+#endif
+					}
+				}
+
+				m_Iterator.increment(ec);
+				if (ec)
+				{
+					m_Error = ec;
+					m_Iterator = fs::directory_iterator();
+				}
+				return true;
+			}
+			return false;
+		}
+
+#ifdef _WIN32
+		bool NextWin32(DirEntry& entry)
+		{
+			if (m_Find == INVALID_HANDLE_VALUE)
+				return false;
+
+			for (;;)
+			{
+				if (!m_HasPending)
+				{
+					enumSyscalls++;
+					if (!FindNextFileW(m_Find, &m_FindData))
+						return false;
+				}
+				m_HasPending = false;
+
+				const WCHAR* fileName = m_FindData.cFileName;
+				if (fileName[0] == L'.' && (fileName[1] == L'\0' || (fileName[1] == L'.' && fileName[2] == L'\0')))
+					continue;
+
+				int length = WideCharToMultiByte(CP_ACP, 0, fileName, -1, m_Name, sizeof(m_Name), nullptr, nullptr);
+				if (length == 0)
+					continue;
+
+				entry.name = m_Name;
+				entry.nameLength = (uint32_t)(length - 1);
+				entry.kind = (m_FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? EntryKind::Folder : EntryKind::File;
+				entry.size = ((uint64_t)m_FindData.nFileSizeHigh << 32) | m_FindData.nFileSizeLow;
+				entry.last_changed = ((uint64_t)m_FindData.ftLastWriteTime.dwHighDateTime << 32) | m_FindData.ftLastWriteTime.dwLowDateTime;
+				return true;
+			}
+		}
+#else
+		bool NextGetdents(DirEntry& entry)
+		{
+			if (m_Fd < 0)
+				return false;
+
+			for (;;)
+			{
+				if (m_BufferPos >= m_BufferEnd)
+				{
+					long count = syscall(SYS_getdents64, m_Fd, m_Buffer.get(), GETDENTS_BUFFER_SIZE);
+					enumSyscalls++;
+					if (count <= 0)
+					{
+						if (count < 0)
+							m_Error = std::error_code(errno, std::generic_category());
+						return false;
+					}
+					m_BufferPos = 0;
+					m_BufferEnd = (size_t)count;
+
+					if (m_Backend == EnumBackend::IoUring)
+						PrefetchStats();
+				}
+
+				auto* dirent = reinterpret_cast<linux_dirent64*>(m_Buffer.get() + m_BufferPos);
+				m_BufferPos += dirent->d_reclen;
+
+				if (IsDotEntry(dirent->d_name))
+					continue;
+
+				entry.name = dirent->d_name;
+				entry.nameLength = (uint32_t)strlen(dirent->d_name);
+				entry.kind = dirent->d_type == DT_DIR ? EntryKind::Folder : EntryKind::File;
+				entry.size = 0;
+				entry.last_changed = 0;
+
+				// d_type answers file vs folder for free on every common filesystem,
+				// so only stat when the caller wants size/time or the fs didn't say.
+				bool needTime = (m_Flags & EnumFlags_Time) != 0;
+				if (m_StatPos < m_StatCount && NeedsStat(dirent->d_type))
+				{
+					const struct statx& stx = m_Stats[m_StatPos];
+					if (m_StatErrors[m_StatPos++] == 0)
+					{
+						entry.kind = S_ISDIR(stx.stx_mode) ? EntryKind::Folder : EntryKind::File;
+						if ((m_Flags & EnumFlags_Size) && entry.kind == EntryKind::File)
+							entry.size = (uint64_t)stx.stx_size;
+						if (needTime)
+							entry.last_changed = (uint64_t)stx.stx_mtime.tv_sec * 10000000ULL + stx.stx_mtime.tv_nsec / 100 + FILETIME_UNIX_EPOCH;
+					}
+				}
+				else if (NeedsStat(dirent->d_type))
+				{
+					struct stat st;
+					enumSyscalls++;
+					if (fstatat(m_Fd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+					{
+						entry.kind = S_ISDIR(st.st_mode) ? EntryKind::Folder : EntryKind::File;
+						if ((m_Flags & EnumFlags_Size) && entry.kind == EntryKind::File)
+							entry.size = (uint64_t)st.st_size;
+						if (needTime)
+							entry.last_changed = TimespecToFileTime(st.st_mtim);
+					}
+					else
+					{
+						m_Error = std::error_code(errno, std::generic_category());
+					}
+				}
+				return true;
+			}
+		}
+#endif
+
+#ifndef _WIN32
+		bool NeedsStat(unsigned char type) const
+		{
+			bool needSize = (m_Flags & EnumFlags_Size) && type != DT_DIR;
+			return needSize || (m_Flags & EnumFlags_Time) || type == DT_UNKNOWN;
+		}
+
+		// Issues the stats for a whole getdents buffer through io_uring, so the
+		// entries that follow are served from m_Stats in the same order.
+		void PrefetchStats()
+		{
+			m_StatPos = m_StatCount = 0;
+			IoRing* ring = ThreadRing();
+			if (!ring)
+				return;
+
+			m_StatNames.clear();
+			for (size_t pos = 0; pos < m_BufferEnd;)
+			{
+				auto* dirent = reinterpret_cast<linux_dirent64*>(m_Buffer.get() + pos);
+				pos += dirent->d_reclen;
+				if (!IsDotEntry(dirent->d_name) && NeedsStat(dirent->d_type))
+					m_StatNames.push_back(dirent->d_name);
+			}
+
+			m_Stats.resize(std::max(m_Stats.size(), m_StatNames.size()));
+			m_StatErrors.resize(std::max(m_StatErrors.size(), m_StatNames.size()));
+			uint64_t enters = ring->EnterCount();
+			if (BatchStatx(*ring, m_Fd, m_StatNames.data(), m_Stats.data(), m_StatErrors.data(), m_StatNames.size()))
+				m_StatCount = m_StatNames.size();
+			enumSyscalls += ring->EnterCount() - enters;
+		}
+#endif
+
+		uint32_t m_Flags = EnumFlags_All;
+		EnumBackend m_Backend = EnumBackend::Native;
+		std::error_code m_Error;
+
+		std::filesystem::directory_iterator m_Iterator;
+		std::string m_StdName;
+
+#ifdef _WIN32
+		HANDLE m_Find = INVALID_HANDLE_VALUE;
+		WIN32_FIND_DATAW m_FindData;
+		bool m_HasPending = false;
+		char m_Name[MAX_PATH * 4];
+#else
+		int m_Fd = -1;
+		std::unique_ptr<char[]> m_Buffer;
+		size_t m_BufferPos = 0;
+		size_t m_BufferEnd = 0;
+		size_t m_StatPos = 0;
+		size_t m_StatCount = 0;
+
+		// Stats prefetched for the current getdents buffer. Per reader, since a
+		// visitor may open another one on the same thread.
+		std::vector<const char*> m_StatNames;
+		std::vector<struct statx> m_Stats;
+		std::vector<int> m_StatErrors;
+#endif
+	};
+
+	// A fixed-size group of entries whose names live in the batch's own
+	// buffer, so visitors see a whole run of entries per call without any
+	// per-entry allocation. Batches are recycled; don't keep views around.
+	struct EntryBatch {
+		DirEntry entries[ENUM_BATCH_SIZE];
+		uint32_t count = 0;
+
+		char names[ENUM_BATCH_NAMES_SIZE];
+		size_t namesUsed = 0;
+
+		const DirEntry* begin() const { return entries; }
+		const DirEntry* end() const { return entries + count; }
+		bool Empty() const { return count == 0; }
+
+		void Clear()
+		{
+			count = 0;
+			namesUsed = 0;
+		}
+
+		// Returns false when the entry doesn't fit; flush and try again.
+		bool Push(const DirEntry& entry)
+		{
+			if (count == ENUM_BATCH_SIZE || namesUsed + entry.nameLength + 1 > ENUM_BATCH_NAMES_SIZE)
+				return false;
+
+			char* name = names + namesUsed;
+			memcpy(name, entry.name, entry.nameLength);
+			name[entry.nameLength] = '\0';
+			namesUsed += entry.nameLength + 1;
+
+			DirEntry& slot = entries[count++];
+			slot = entry;
+			slot.name = name;
+			return true;
+		}
+	};
+
+	// Visitors may enumerate other directories from inside the callback, so
+	// hand out batches from a small per-thread free list instead of a single
+	// thread_local batch.
+	static thread_local std::vector<std::unique_ptr<EntryBatch>> entryBatches;
+
+	static std::unique_ptr<EntryBatch> AcquireEntryBatch()
+	{
+		if (entryBatches.empty())
+			return std::make_unique<EntryBatch>();
+
+		auto batch = std::move(entryBatches.back());
+		entryBatches.pop_back();
+		batch->Clear();
+		return batch;
+	}
+
+	static void ReleaseEntryBatch(std::unique_ptr<EntryBatch> batch)
+	{
+		if (batch && entryBatches.size() < 4)
+			entryBatches.push_back(std::move(batch));
+	}
+
+	// Streams `directoryPath` to `visitor(const EntryBatch&)` in batches of up to
+	// ENUM_BATCH_SIZE entries. The visitor may return false to stop early.
+	// Returns false if the directory couldn't be opened.
+	template<typename Visitor>
+	static bool EnumerateDirectory(const std::string& directoryPath, uint32_t flags, Visitor&& visitor)
+	{
+		DirReader reader;
+		if (!reader.Open(directoryPath, flags))
+			return false;
+
+		auto visit = [&visitor](const EntryBatch& batch) {
+			if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, const EntryBatch&>, bool>)
+				return visitor(batch);
+			else
+			{
+				visitor(batch);
+				return true;
+			}
+		};
+
+		auto batch = AcquireEntryBatch();
+		bool keepGoing = true;
+
+		DirEntry entry;
+		while (keepGoing && reader.Next(entry))
+		{
+			if (batch->Push(entry))
+				continue;
+
+			keepGoing = visit(*batch);
+			batch->Clear();
+			batch->Push(entry);
+		}
+
+		if (keepGoing && !batch->Empty())
+			visit(*batch);
+
+		ReleaseEntryBatch(std::move(batch));
+		return true;
+	}
+
+	// Size (files only) and last write time of a single entry, without
+	// listing anything.
+	static bool GetFileInfo(const std::string& path, uint64_t& size, uint64_t& last_changed)
+	{
+#ifdef _WIN32
+		// "C:" alone means the current directory on C:
+		std::string target = path;
+		if (!target.empty() && target.back() == ':')
+			target.push_back(PATH_SEPARATOR);
+
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		enumSyscalls++;
+		if (!GetFileAttributesExA(target.c_str(), GetFileExInfoStandard, &data))
+			return false;
+
+		size = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? 0 : ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+		last_changed = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+		struct stat st;
+		enumSyscalls++;
+		if (lstat(path.c_str(), &st) != 0)
+			return false;
+
+		size = S_ISDIR(st.st_mode) ? 0 : (uint64_t)st.st_size;
+		last_changed = TimespecToFileTime(st.st_mtim);
+#endif
+		return true;
+	}
+
+	// Last write time of a single file or folder, without listing anything.
+	static bool GetLastChanged(const std::string& path, uint64_t& last_changed)
+	{
+		uint64_t size;
+		return GetFileInfo(path, size, last_changed);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,487 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace.h"
+
+#define SEGMENT_QUEUE_SIZE 256
+
+namespace File {
+
+	// A std::mutex that counts how often, and for how long, callers had to
+	// wait for it.
+	class CountingMutex {
+	public:
+		void lock()
+		{
+			m_Locks.fetch_add(1, std::memory_order_relaxed);
+			if (m_Mutex.try_lock())
+				return;
+
+			TRACE_SCOPE("mutex wait");
+			auto start = std::chrono::steady_clock::now();
+			m_Mutex.lock();
+			m_Contended.fetch_add(1, std::memory_order_relaxed);
+			m_WaitNs.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+		}
+
+		bool try_lock()
+		{
+			if (!m_Mutex.try_lock())
+				return false;
+			m_Locks.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		void unlock() { m_Mutex.unlock(); }
+
+		uint64_t Locks() const { return m_Locks.load(std::memory_order_relaxed); }
+		uint64_t Contended() const { return m_Contended.load(std::memory_order_relaxed); }
+		double WaitMilliseconds() const { return m_WaitNs.load(std::memory_order_relaxed) / 1e6; }
+
+		void ResetCounters()
+		{
+			m_Locks = 0;
+			m_Contended = 0;
+			m_WaitNs = 0;
+		}
+
+	private:
+		std::mutex m_Mutex;
+		std::atomic<uint64_t> m_Locks{ 0 };
+		std::atomic<uint64_t> m_Contended{ 0 };
+		std::atomic<uint64_t> m_WaitNs{ 0 };
+	};
+
+	// Unbounded single-producer single-consumer queue made of fixed-size
+	// segments. Push never blocks or locks: it fills the tail segment and
+	// publishes the new count, linking a fresh segment when it's full. The
+	// consumer frees segments as it finishes them.
+	template<typename T>
+	class SegmentQueue {
+	public:
+		SegmentQueue() : m_Head(new Segment()), m_Tail(m_Head) {}
+		SegmentQueue(const SegmentQueue&) = delete;
+		SegmentQueue& operator=(const SegmentQueue&) = delete;
+
+		~SegmentQueue()
+		{
+			while (m_Head)
+			{
+				Segment* next = m_Head->next.load(std::memory_order_relaxed);
+				delete m_Head;
+				m_Head = next;
+			}
+		}
+
+		// Producer only.
+		void Push(T value)
+		{
+			if (m_TailCount == SEGMENT_QUEUE_SIZE)
+			{
+				Segment* segment = new Segment();
+				m_Tail->next.store(segment, std::memory_order_release);
+				m_Tail = segment;
+				m_TailCount = 0;
+				m_Segments.fetch_add(1, std::memory_order_relaxed);
+			}
+			m_Tail->items[m_TailCount] = std::move(value);
+			m_Tail->count.store(++m_TailCount, std::memory_order_release);
+		}
+
+		// Consumer only. Calls fn(item) for everything published so far.
+		template<typename Fn>
+		size_t Drain(Fn&& fn)
+		{
+			size_t drained = 0;
+			for (;;)
+			{
+				size_t count = m_Head->count.load(std::memory_order_acquire);
+				for (; m_ReadPos < count; m_ReadPos++, drained++)
+					fn(std::move(m_Head->items[m_ReadPos]));
+
+				if (m_ReadPos < SEGMENT_QUEUE_SIZE)
+					return drained;
+
+				Segment* next = m_Head->next.load(std::memory_order_acquire);
+				if (!next)
+					return drained;
+				delete m_Head;
+				m_Head = next;
+				m_ReadPos = 0;
+			}
+		}
+
+		// Segments allocated beyond the first
+		uint64_t SegmentCount() const { return m_Segments.load(std::memory_order_relaxed); }
+
+	private:
+		struct Segment {
+			T items[SEGMENT_QUEUE_SIZE];
+			std::atomic<size_t> count{ 0 };
+			std::atomic<Segment*> next{ nullptr };
+		};
+
+		// Consumer side
+		alignas(64) Segment* m_Head;
+		size_t m_ReadPos = 0;
+
+		// Producer side
+		alignas(64) Segment* m_Tail;
+		size_t m_TailCount = 0;
+		std::atomic<uint64_t> m_Segments{ 0 };
+	};
+
+	// Counts the outstanding tasks of one job (a scan or a search). `onDone`
+	// runs on whichever thread finishes the last task, unless the pool was
+	// stopped with some of them still queued: then the group is cancelled,
+	// `onDone` is skipped and Wait returns all the same.
+	class TaskGroup {
+	public:
+		explicit TaskGroup(std::function<void()> onDone = nullptr)
+			: m_OnDone(std::move(onDone))
+		{
+		}
+
+		void Add(int64_t count = 1) { m_Pending.fetch_add(count, std::memory_order_relaxed); }
+
+		void Done()
+		{
+			if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+
+			if (m_OnDone && !Cancelled())
+				m_OnDone();
+			Finish();
+		}
+
+		// A task of the group that will never run.
+		void Cancel()
+		{
+			m_Cancelled.store(true, std::memory_order_relaxed);
+			if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				Finish();
+		}
+
+		bool Cancelled() const { return m_Cancelled.load(std::memory_order_relaxed); }
+
+		int64_t Pending() const { return m_Pending.load(std::memory_order_relaxed); }
+
+		bool Finished() const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Finished;
+		}
+
+		// Don't call from a pool worker; the job may need that worker to finish.
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this] { return m_Finished; });
+		}
+
+	private:
+		void Finish()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Finished = true;
+			m_Condition.notify_all();
+		}
+
+		std::atomic<int64_t> m_Pending{ 0 };
+		std::atomic<bool> m_Cancelled{ false };
+		std::function<void()> m_OnDone;
+
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Finished = false;
+	};
+
+	// Fixed-size pool with one deque per worker. A worker pushes and pops its
+	// own tasks at the back (newest first, so a scan goes depth-first and
+	// stays cache friendly). Idle workers steal from the front of the others,
+	// which is where the oldest, shallowest and usually largest tasks are.
+	class TaskPool {
+	public:
+		using Task = std::function<void()>;
+
+		TaskPool() = default;
+		TaskPool(const TaskPool&) = delete;
+		TaskPool& operator=(const TaskPool&) = delete;
+
+		~TaskPool() { Stop(); }
+
+		// 0 workers means one per hardware thread. The pool isn't started on
+		// first use: Start and Stop belong to the thread that owns the pool,
+		// called while nothing else submits to it.
+		void Start(unsigned workerCount = 0)
+		{
+			if (!m_Workers.empty())
+				return;
+
+			if (workerCount == 0)
+				workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+			m_Stop = false;
+			m_StartTime = std::chrono::steady_clock::now();
+			for (unsigned i = 0; i < workerCount; i++)
+				m_Workers.push_back(std::make_unique<Worker>());
+			for (unsigned i = 0; i < workerCount; i++)
+				m_Workers[i]->thread = std::thread(&TaskPool::Run, this, i);
+		}
+
+		// Finishes the task each worker is running, joins, and cancels the
+		// queued ones so every group still completes.
+		void Stop()
+		{
+			if (m_Workers.empty())
+				return;
+
+			{
+				std::lock_guard<std::mutex> lock(m_SleepMutex);
+				m_Stop = true;
+			}
+			m_Wake.notify_all();
+
+			for (auto& worker : m_Workers)
+			{
+				if (worker->thread.joinable())
+					worker->thread.join();
+			}
+			for (auto& worker : m_Workers)
+			{
+				for (Queued& queued : worker->tasks)
+					queued.group->Cancel();
+			}
+			m_Workers.clear();
+			m_Queued = 0;
+		}
+
+		unsigned WorkerCount() const { return (unsigned)m_Workers.size(); }
+
+		// What one worker has done since Start(), for telemetry.
+		struct WorkerActivity {
+			uint64_t busyNanoseconds = 0;
+			uint64_t tasks = 0;
+			uint64_t steals = 0;
+			size_t queued = 0;
+		};
+
+		WorkerActivity Activity(unsigned index) const
+		{
+			Worker& worker = *m_Workers[index];
+			WorkerActivity activity;
+			activity.busyNanoseconds = worker.counters.busyNanoseconds.load(std::memory_order_relaxed);
+			activity.tasks = worker.counters.tasks.load(std::memory_order_relaxed);
+			activity.steals = worker.counters.steals.load(std::memory_order_relaxed);
+
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			activity.queued = worker.tasks.size();
+			return activity;
+		}
+
+		uint64_t NanosecondsRunning() const
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_StartTime).count();
+		}
+
+		int64_t QueuedTasks() const { return m_Queued.load(std::memory_order_relaxed); }
+
+		bool IsWorkerThread() const { return t_Pool == this; }
+
+		// Index of the calling worker; only meaningful when IsWorkerThread().
+		unsigned WorkerIndex() const { return t_Index; }
+
+		void Submit(const std::shared_ptr<TaskGroup>& group, Task task)
+		{
+			group->Add();
+			if (m_Workers.empty())
+			{
+				// Not started, or stopped: nothing would ever run it
+				group->Cancel();
+				return;
+			}
+
+			Task wrapped = [group, task = std::move(task)]() {
+				try
+				{
+					task();
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << e.what() << "\n";
+				}
+				group->Done();
+			};
+
+			// Workers keep their own children local; everything else is spread round-robin
+			unsigned index = IsWorkerThread() ? t_Index : m_NextInject.fetch_add(1, std::memory_order_relaxed) % WorkerCount();
+			{
+				Worker& worker = *m_Workers[index];
+				std::lock_guard<std::mutex> lock(worker.mutex);
+				worker.tasks.push_back({ std::move(wrapped), group });
+			}
+
+			m_Queued.fetch_add(1, std::memory_order_release);
+			{
+				std::lock_guard<std::mutex> lock(m_SleepMutex);
+			}
+			m_Wake.notify_one();
+		}
+
+		// Runs fn(i) for every i below count on the pool and the calling thread
+		// and returns when all are done. The caller claims indices too, so it
+		// never waits on a task still sitting in a queue and is safe to use
+		// from a worker.
+		void ParallelFor(size_t count, const std::function<void(size_t)>& fn)
+		{
+			struct State {
+				std::function<void(size_t)> fn;
+				size_t count = 0;
+				std::atomic<size_t> next{ 0 };
+				std::atomic<size_t> done{ 0 };
+				std::mutex mutex;
+				std::condition_variable finished;
+			};
+			auto state = std::make_shared<State>();
+			state->fn = fn;
+			state->count = count;
+
+			auto work = [state]() {
+				size_t index;
+				while ((index = state->next.fetch_add(1, std::memory_order_relaxed)) < state->count)
+				{
+					try
+					{
+						state->fn(index);
+					}
+					catch (const std::exception& e)
+					{
+						std::cerr << e.what() << "\n";
+					}
+
+					if (state->done.fetch_add(1, std::memory_order_acq_rel) + 1 == state->count)
+					{
+						std::lock_guard<std::mutex> lock(state->mutex);
+						state->finished.notify_all();
+					}
+				}
+			};
+
+			auto group = std::make_shared<TaskGroup>();
+			size_t helpers = std::min<size_t>(count > 0 ? count - 1 : 0, WorkerCount());
+			for (size_t i = 0; i < helpers; i++)
+				Submit(group, work);
+
+			work();
+
+			std::unique_lock<std::mutex> lock(state->mutex);
+			state->finished.wait(lock, [&state] { return state->done.load(std::memory_order_acquire) == state->count; });
+		}
+
+	private:
+		struct Queued {
+			Task task;
+			std::shared_ptr<TaskGroup> group; // to cancel it if the pool stops first
+		};
+
+		struct alignas(64) Worker {
+			std::mutex mutex;
+			std::deque<Queued> tasks;
+			std::thread thread;
+
+			// Written only by the worker itself; on their own line so thieves
+			// taking the mutex don't bounce it.
+			struct alignas(64) Counters {
+				std::atomic<uint64_t> busyNanoseconds{ 0 };
+				std::atomic<uint64_t> tasks{ 0 };
+				std::atomic<uint64_t> steals{ 0 };
+			} counters;
+		};
+
+		bool PopLocal(unsigned index, Task& task)
+		{
+			Worker& worker = *m_Workers[index];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			if (worker.tasks.empty())
+				return false;
+
+			task = std::move(worker.tasks.back().task);
+			worker.tasks.pop_back();
+			return true;
+		}
+
+		bool Steal(unsigned thief, Task& task)
+		{
+			unsigned count = WorkerCount();
+			for (unsigned i = 1; i < count; i++)
+			{
+				Worker& victim = *m_Workers[(thief + i) % count];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (victim.tasks.empty())
+					continue;
+
+				task = std::move(victim.tasks.front().task);
+				victim.tasks.pop_front();
+				return true;
+			}
+			return false;
+		}
+
+		void Run(unsigned index)
+		{
+			t_Pool = this;
+			t_Index = index;
+			Tracing.NameThread("worker " + std::to_string(index));
+
+			while (!m_Stop.load(std::memory_order_relaxed))
+			{
+				Task task;
+				bool stolen = false;
+				if (PopLocal(index, task) || (stolen = Steal(index, task)))
+				{
+					m_Queued.fetch_sub(1, std::memory_order_relaxed);
+					auto start = std::chrono::steady_clock::now();
+					task();
+
+					Worker::Counters& counters = m_Workers[index]->counters;
+					auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+					counters.busyNanoseconds.fetch_add((uint64_t)busy, std::memory_order_relaxed);
+					counters.tasks.fetch_add(1, std::memory_order_relaxed);
+					if (stolen)
+						counters.steals.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(m_SleepMutex);
+				m_Wake.wait(lock, [this] { return m_Stop.load(std::memory_order_relaxed) || m_Queued.load(std::memory_order_acquire) > 0; });
+			}
+
+			t_Pool = nullptr;
+		}
+
+		std::vector<std::unique_ptr<Worker>> m_Workers;
+		std::atomic<unsigned> m_NextInject{ 0 };
+		std::atomic<int64_t> m_Queued{ 0 };
+		std::chrono::steady_clock::time_point m_StartTime;
+
+		std::mutex m_SleepMutex;
+		std::condition_variable m_Wake;
+		std::atomic<bool> m_Stop{ false };
+
+		static inline thread_local TaskPool* t_Pool = nullptr;
+		static inline thread_local unsigned t_Index = 0;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "nametable.h"
+
+#define MATCHER_SHORT_NAME 64 // names up to this long are matched from a padded copy
+
+namespace File {
+
+	// Case-insensitive (ASCII) substring matcher, compiled once per query and
+	// then run against every name visited without allocating. Sixteen
+	// positions at a time are tested against both cases of the query's first
+	// and last byte; only positions passing both are compared in full.
+	class NameMatcher {
+	public:
+		explicit NameMatcher(std::string_view query)
+		{
+			m_Folded.assign(query.data(), query.size());
+			for (char& c : m_Folded)
+				c = FoldChar(c);
+
+			if (!m_Folded.empty())
+			{
+				m_FirstLower = m_Folded.front();
+				m_FirstUpper = UpperChar(m_FirstLower);
+				m_LastLower = m_Folded.back();
+				m_LastUpper = UpperChar(m_LastLower);
+			}
+		}
+
+		const std::string& Query() const { return m_Folded; }
+
+		bool Matches(std::string_view name) const
+		{
+			size_t n = m_Folded.size();
+			if (n == 0)
+				return true;
+			if (name.size() < n)
+				return false;
+
+#ifdef NAME_SCAN_X86
+			if (name.size() <= MATCHER_SHORT_NAME)
+			{
+				// Room for the last 16-byte load of both probes past the end
+				char padded[MATCHER_SHORT_NAME + 32];
+				memcpy(padded, name.data(), name.size());
+				memset(padded + name.size(), 0, 32);
+				return MatchSse2(padded, name.size() - n + 1);
+			}
+
+			// Only blocks whose loads stay inside the name run in place; the rest is scalar
+			size_t blocks = name.size() >= n + 15 ? (name.size() - n - 15) / 16 * 16 + 16 : 0;
+			if (blocks && MatchSse2(name.data(), blocks))
+				return true;
+			return MatchScalar(name, blocks);
+#else
+			return MatchScalar(name, 0);
+#endif
+		}
+
+	private:
+		static char UpperChar(char c) { return c >= 'a' && c <= 'z' ? (char)(c - ('a' - 'A')) : c; }
+
+		// Compares the query against `at`, skipping the first and last byte.
+		bool MiddleMatches(const char* at) const
+		{
+			for (size_t i = 1; i + 1 < m_Folded.size(); i++)
+			{
+				if (FoldChar(at[i]) != m_Folded[i])
+					return false;
+			}
+			return true;
+		}
+
+		bool MatchScalar(std::string_view name, size_t from) const
+		{
+			size_t n = m_Folded.size();
+			for (size_t pos = from; pos + n <= name.size(); pos++)
+			{
+				char first = name[pos];
+				char last = name[pos + n - 1];
+				if ((first == m_FirstLower || first == m_FirstUpper) && (last == m_LastLower || last == m_LastUpper) && MiddleMatches(name.data() + pos))
+					return true;
+			}
+			return false;
+		}
+
+#ifdef NAME_SCAN_X86
+		// Tests the first `positions` start positions of `data`; every 16-byte
+		// load of both probes must be readable.
+		bool MatchSse2(const char* data, size_t positions) const
+		{
+			size_t n = m_Folded.size();
+			const __m128i firstLower = _mm_set1_epi8(m_FirstLower);
+			const __m128i firstUpper = _mm_set1_epi8(m_FirstUpper);
+			const __m128i lastLower = _mm_set1_epi8(m_LastLower);
+			const __m128i lastUpper = _mm_set1_epi8(m_LastUpper);
+
+			for (size_t pos = 0; pos < positions; pos += 16)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(data + pos));
+				__m128i b = _mm_loadu_si128((const __m128i*)(data + pos + n - 1));
+				__m128i first = _mm_or_si128(_mm_cmpeq_epi8(a, firstLower), _mm_cmpeq_epi8(a, firstUpper));
+				__m128i last = _mm_or_si128(_mm_cmpeq_epi8(b, lastLower), _mm_cmpeq_epi8(b, lastUpper));
+				unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(first, last));
+				if (positions - pos < 16)
+					mask &= (1u << (positions - pos)) - 1;
+
+				while (mask)
+				{
+					unsigned bit = LowestBit(mask);
+					if (MiddleMatches(data + pos + bit))
+						return true;
+					mask &= mask - 1;
+				}
+			}
+			return false;
+		}
+#endif
+
+		std::string m_Folded;
+		char m_FirstLower = 0;
+		char m_FirstUpper = 0;
+		char m_LastLower = 0;
+		char m_LastUpper = 0;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define MEMORY_FILE "memory.json"
+
+namespace File {
+
+	// What the heap really takes for a request of `bytes`: its block header
+	// and rounding included, so many small nodes aren't undercounted.
+	static size_t HeapBlockSize(size_t bytes)
+	{
+		if (bytes == 0)
+			return 0;
+#ifdef _WIN32
+		// NT heap: an 8/16 byte entry header, 16 byte granules
+		return (bytes + 2 * sizeof(void*) + 15) & ~(size_t)15;
+#else
+		// glibc malloc: an 8 byte size field, 16 byte chunks, 32 at least
+		return std::max<size_t>(32, (bytes + sizeof(size_t) + 15) & ~(size_t)15);
+#endif
+	}
+
+	// Heap bytes behind a string; none while it fits the small string buffer.
+	static size_t StringHeapBytes(const std::string& text)
+	{
+		const char* data = text.data();
+		bool local = data >= (const char*)&text && data < (const char*)(&text + 1);
+		return local ? 0 : HeapBlockSize(text.capacity() + 1);
+	}
+
+	template<typename T>
+	static size_t VectorHeapBytes(const std::vector<T>& items)
+	{
+		return HeapBlockSize(items.capacity() * sizeof(T));
+	}
+
+	// One entry of an unordered_map keyed by an integer: its node and its
+	// share of the bucket array at a load factor of one. Node layouts are
+	// the standard libraries' own; integer hashes are never cached in them.
+	template<typename Map>
+	static size_t HashMapEntryBytes()
+	{
+		using Value = typename Map::value_type;
+		constexpr size_t align = alignof(Value);
+#if defined(_MSVC_STL_VERSION)
+		// A std::list node (next, prev) and two bucket iterators
+		return HeapBlockSize(((2 * sizeof(void*) + align - 1) & ~(align - 1)) + sizeof(Value)) + 2 * sizeof(void*);
+#elif defined(_LIBCPP_VERSION)
+		// next and the hash
+		return HeapBlockSize(((sizeof(void*) + sizeof(size_t) + align - 1) & ~(align - 1)) + sizeof(Value)) + sizeof(void*);
+#else
+		// libstdc++: next only
+		return HeapBlockSize(((sizeof(void*) + align - 1) & ~(align - 1)) + sizeof(Value)) + sizeof(void*);
+#endif
+	}
+
+	template<typename Map>
+	static size_t HashMapHeapBytes(const Map& map)
+	{
+		size_t entry = HashMapEntryBytes<Map>();
+#if defined(_MSVC_STL_VERSION)
+		// The list's sentinel node is allocated too
+		size_t node = entry - 2 * sizeof(void*);
+		return (map.size() + 1) * node + HeapBlockSize(2 * map.bucket_count() * sizeof(void*));
+#else
+		// A single bucket lives inside the map
+		size_t node = entry - sizeof(void*);
+		return map.size() * node + (map.bucket_count() > 1 ? HeapBlockSize(map.bucket_count() * sizeof(void*)) : 0);
+#endif
+	}
+
+	struct MemoryEntry {
+		const char* key; // JSON name
+		const char* label;
+		size_t entries = 0;
+		size_t bytes = 0;
+	};
+
+	// Bytes held by the structures that grow with what was scanned or found.
+	struct MemoryReport {
+		std::vector<MemoryEntry> structures;
+		size_t folderSizeBudget = 0; // bytes, 0 = no limit
+		size_t folderSizeBytes = 0; // what the budget is measured against
+		uint64_t evicted = 0;
+
+		size_t Total() const
+		{
+			size_t total = 0;
+			for (const MemoryEntry& entry : structures)
+				total += entry.bytes;
+			return total;
+		}
+	};
+
+	static std::string MemoryJson(const MemoryReport& report)
+	{
+		std::ostringstream out;
+		out << "{\"total_bytes\":" << report.Total() << ",\"folder_size_budget\":" << report.folderSizeBudget
+			<< ",\"folder_size_bytes\":" << report.folderSizeBytes << ",\"evicted\":" << report.evicted;
+		for (const MemoryEntry& entry : report.structures)
+			out << ",\"" << entry.key << "\":{\"entries\":" << entry.entries << ",\"bytes\":" << entry.bytes << "}";
+		out << "}";
+		return out.str();
+	}
+
+	static bool SaveMemoryJson(const char* path, const MemoryReport& report)
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file)
+			return false;
+
+		std::string json = MemoryJson(report);
+		bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+		return std::fclose(file) == 0 && written;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define NAME_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define NAME_SCAN_AVX2
+#else
+#include <cpuid.h>
+#define NAME_SCAN_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace File {
+
+	static inline unsigned LowestBit(unsigned mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (unsigned)index;
+#else
+		return (unsigned)__builtin_ctz(mask);
+#endif
+	}
+
+	static inline char FoldChar(char c) { return c >= 'A' && c <= 'Z' ? (char)(c + ('a' - 'A')) : c; }
+
+	// First occurrence of `needle` in [begin, end), or nullptr. Both sides must
+	// already be folded; this is a plain byte search.
+	static const char* FindBytesScalar(const char* begin, const char* end, std::string_view needle)
+	{
+		size_t n = needle.size();
+		if (n == 0)
+			return begin;
+		for (const char* p = begin; p + n <= end; p++)
+		{
+			p = (const char*)memchr(p, needle[0], (size_t)(end - p) - n + 1);
+			if (!p)
+				return nullptr;
+			if (memcmp(p + 1, needle.data() + 1, n - 1) == 0)
+				return p;
+		}
+		return nullptr;
+	}
+
+#ifdef NAME_SCAN_X86
+	// Compares the needle's first and last byte against 16 (or 32) positions
+	// at once and only memcmp()s the positions where both match.
+	static const char* FindBytesSse2(const char* begin, const char* end, std::string_view needle)
+	{
+		size_t n = needle.size();
+		if (n == 0)
+			return begin;
+		if ((size_t)(end - begin) < n)
+			return nullptr;
+
+		const __m128i first = _mm_set1_epi8(needle[0]);
+		const __m128i last = _mm_set1_epi8(needle[n - 1]);
+		const char* p = begin;
+		for (; p + n - 1 + 16 <= end; p += 16)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)p);
+			__m128i b = _mm_loadu_si128((const __m128i*)(p + n - 1));
+			unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+			while (mask)
+			{
+				unsigned bit = LowestBit(mask);
+				if (n <= 2 || memcmp(p + bit + 1, needle.data() + 1, n - 2) == 0)
+					return p + bit;
+				mask &= mask - 1;
+			}
+		}
+		return FindBytesScalar(p, end, needle);
+	}
+
+	NAME_SCAN_AVX2 static const char* FindBytesAvx2(const char* begin, const char* end, std::string_view needle)
+	{
+		size_t n = needle.size();
+		if (n == 0)
+			return begin;
+		if ((size_t)(end - begin) < n)
+			return nullptr;
+
+		const __m256i first = _mm256_set1_epi8(needle[0]);
+		const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+		const char* p = begin;
+		for (; p + n - 1 + 32 <= end; p += 32)
+		{
+			__m256i a = _mm256_loadu_si256((const __m256i*)p);
+			__m256i b = _mm256_loadu_si256((const __m256i*)(p + n - 1));
+			unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+			while (mask)
+			{
+				unsigned bit = LowestBit(mask);
+				if (n <= 2 || memcmp(p + bit + 1, needle.data() + 1, n - 2) == 0)
+					return p + bit;
+				mask &= mask - 1;
+			}
+		}
+		return FindBytesSse2(p, end, needle);
+	}
+
+	static bool CpuHasAvx2()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		return avx2 && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	enum class NameScanKernel { Scalar, Sse2, Avx2 };
+
+	static NameScanKernel BestNameScanKernel()
+	{
+#ifdef NAME_SCAN_X86
+		static const NameScanKernel best = CpuHasAvx2() ? NameScanKernel::Avx2 : NameScanKernel::Sse2;
+		return best;
+#else
+		return NameScanKernel::Scalar;
+#endif
+	}
+
+	static const char* FindBytes(const char* begin, const char* end, std::string_view needle, NameScanKernel kernel = BestNameScanKernel())
+	{
+		switch (kernel)
+		{
+#ifdef NAME_SCAN_X86
+		case NameScanKernel::Avx2: return FindBytesAvx2(begin, end, needle);
+		case NameScanKernel::Sse2: return FindBytesSse2(begin, end, needle);
+#endif
+		default: return FindBytesScalar(begin, end, needle);
+		}
+	}
+
+	// Every name of a table, lower-cased, back to back in one buffer and
+	// separated by '\0' so a match can't span two names. A query sweeps the
+	// whole buffer with FindBytes and maps each hit back to its name through
+	// the offsets, instead of folding and searching one name at a time. The
+	// table only points at the names and offsets; the name index keeps both
+	// in its mapped file.
+	class FoldedNameTable {
+	public:
+		// `count` ascending offsets into `names`, the first at `offsets` and
+		// each `stride` bytes after the one before (a field of a record array).
+		void Attach(const char* names, size_t size, const uint32_t* offsets, size_t stride, uint32_t count)
+		{
+			m_Names = names;
+			m_Size = size;
+			m_Offsets = (const char*)offsets;
+			m_Stride = stride;
+			m_Count = count;
+		}
+
+		void Clear() { *this = FoldedNameTable(); }
+
+		uint32_t Count() const { return m_Count; }
+		size_t Bytes() const { return m_Size; }
+
+		bool Contains(uint32_t index, std::string_view folded) const
+		{
+			const char* begin = m_Names + Offset(index);
+			const char* end = m_Names + End(index);
+			return FindBytes(begin, end, folded) != nullptr;
+		}
+
+		// Calls onMatch(index) in order for every name in [first, last) that
+		// contains `folded`, until it returns false.
+		template<typename Fn>
+		void Scan(std::string_view folded, uint32_t first, uint32_t last, Fn&& onMatch, NameScanKernel kernel = BestNameScanKernel()) const
+		{
+			last = std::min(last, Count());
+			if (first >= last || folded.empty())
+				return;
+
+			const char* p = m_Names + Offset(first);
+			const char* end = m_Names + End(last - 1);
+			while (p < end)
+			{
+				const char* hit = FindBytes(p, end, folded, kernel);
+				if (!hit)
+					return;
+
+				// The last name starting at or before the hit
+				size_t at = (size_t)(hit - m_Names);
+				uint32_t low = first, high = last;
+				while (low < high)
+				{
+					uint32_t middle = low + (high - low) / 2;
+					if (Offset(middle) <= at)
+						low = middle + 1;
+					else
+						high = middle;
+				}
+				uint32_t index = low - 1;
+				if (!onMatch(index))
+					return;
+				p = m_Names + End(index);
+			}
+		}
+
+	private:
+		uint32_t Offset(uint32_t index) const { return *(const uint32_t*)(m_Offsets + index * m_Stride); }
+
+		// One past the name's terminator
+		size_t End(uint32_t index) const { return index + 1 < m_Count ? Offset(index + 1) : m_Size; }
+
+		const char* m_Names = nullptr;
+		size_t m_Size = 0;
+		const char* m_Offsets = nullptr;
+		size_t m_Stride = sizeof(uint32_t);
+		uint32_t m_Count = 0;
+	};
+
+}
\ No newline at end of file
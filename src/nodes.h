@@ -0,0 +1,624 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "enumerate.h"
+#include "memory.h"
+
+#define NODE_CHUNK_SHIFT 16
+#define NODE_CHUNK_SIZE (1u << NODE_CHUNK_SHIFT)
+#define NODE_CHUNK_COUNT 1024 // at most 64M nodes (2.5 GB); see NodeTable
+#define NAME_CHUNK_SHIFT 20
+#define NAME_CHUNK_SIZE (1u << NAME_CHUNK_SHIFT)
+#define NAME_CHUNK_COUNT 4096
+
+namespace File {
+
+	using NodeId = uint32_t;
+	constexpr NodeId InvalidNode = 0xFFFFFFFF;
+
+	enum NodeFlags : uint8_t {
+		NodeFlags_None = 0,
+		NodeFlags_Listed = 1 << 0, // read at least once, entryCount is valid
+	};
+
+	// One scanned entry. The full path is never stored: it is rebuilt from the
+	// parent chain, and the name lives in the table's shared name pool.
+	struct Node {
+		uint64_t size = 0;
+		uint64_t last_changed = 0;
+		NodeId parent = InvalidNode;
+		NodeId firstChild = InvalidNode;
+		NodeId nextSibling = InvalidNode;
+		uint32_t nameOffset = 0;
+		uint32_t entryCount = 0; // children seen the last time the folder was read
+		uint16_t nameLength = 0;
+		EntryKind kind = EntryKind::File;
+		uint8_t flags = 0;
+	};
+
+	// Entries of one directory, gathered from its batches so they can be merged
+	// into the table under a single lock.
+	struct DirListing {
+		std::vector<DirEntry> entries;
+		std::vector<uint32_t> nameOffsets;
+		std::string names;
+		uint32_t flags = EnumFlags_All; // whether entries carry their size and time
+
+		void Clear()
+		{
+			entries.clear();
+			nameOffsets.clear();
+			names.clear();
+		}
+
+		size_t Size() const { return entries.size(); }
+
+		std::string_view Name(size_t i) const { return std::string_view(names.data() + nameOffsets[i], entries[i].nameLength); }
+
+		void Append(const EntryBatch& batch)
+		{
+			for (const DirEntry& entry : batch)
+			{
+				nameOffsets.push_back((uint32_t)names.size());
+				names.append(entry.name, entry.nameLength);
+				DirEntry& copy = entries.emplace_back(entry);
+				copy.name = nullptr; // use Name(i), `names` may reallocate
+			}
+		}
+	};
+
+	static bool NamesEqual(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size())
+			return false;
+#ifdef _WIN32
+		// NTFS names are case-insensitive
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			unsigned char ca = (unsigned char)a[i], cb = (unsigned char)b[i];
+			if (ca != cb && std::tolower(ca) != std::tolower(cb))
+				return false;
+		}
+		return true;
+#else
+		return a == b;
+#endif
+	}
+
+	// Orders names so that the ones NamesEqual matches sort together.
+	static int CompareNames(std::string_view a, std::string_view b)
+	{
+#ifdef _WIN32
+		size_t length = std::min(a.size(), b.size());
+		for (size_t i = 0; i < length; i++)
+		{
+			int ca = std::tolower((unsigned char)a[i]), cb = std::tolower((unsigned char)b[i]);
+			if (ca != cb)
+				return ca < cb ? -1 : 1;
+		}
+		return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+#else
+		return a.compare(b);
+#endif
+	}
+
+	static bool IsPathSeparator(char c)
+	{
+#ifdef _WIN32
+		return c == '\\' || c == '/';
+#else
+		return c == '/';
+#endif
+	}
+
+	// Append-only table of entries with parent links and interned names.
+	// Writers are serialised by an internal mutex; readers never lock. Node and
+	// name storage is chunked so published ids stay valid while the table grows.
+	// Ids only ever name one path, since caches and results hold them: entries
+	// that vanish from a folder are unlinked but keep their slot, and an entry
+	// that shows up again under the same name gets that slot back. Growth is
+	// bounded by NODE_CHUNK_COUNT nodes and NAME_CHUNK_COUNT name chunks; once
+	// either is used up nothing more is added (InvalidNode) until the next start.
+	class NodeTable {
+	public:
+		NodeTable() = default;
+		NodeTable(const NodeTable&) = delete;
+		NodeTable& operator=(const NodeTable&) = delete;
+
+		~NodeTable()
+		{
+			for (size_t i = 0; i < NODE_CHUNK_COUNT; i++)
+				delete[] m_NodeChunks[i].load();
+			for (size_t i = 0; i < NAME_CHUNK_COUNT; i++)
+				delete[] m_NameChunks[i].load();
+		}
+
+		size_t Count() const { return m_Count.load(std::memory_order_acquire); }
+		size_t UnlinkedCount() const { return m_Unlinked.load(std::memory_order_relaxed); }
+		bool Full() const { return m_Full.load(std::memory_order_relaxed); }
+
+		const Node& Get(NodeId id) const { return Slot(id); }
+
+		std::string_view Name(NodeId id) const
+		{
+			const Node& node = Slot(id);
+			const char* chunk = m_NameChunks[node.nameOffset >> NAME_CHUNK_SHIFT].load(std::memory_order_acquire);
+			return std::string_view(chunk + (node.nameOffset & (NAME_CHUNK_SIZE - 1)), node.nameLength);
+		}
+
+		NodeId Parent(NodeId id) const { return Slot(id).parent; }
+
+		NodeId FirstChild(NodeId id) const
+		{
+			return std::atomic_ref<NodeId>(Slot(id).firstChild).load(std::memory_order_acquire);
+		}
+
+		NodeId NextSibling(NodeId id) const
+		{
+			return std::atomic_ref<NodeId>(Slot(id).nextSibling).load(std::memory_order_acquire);
+		}
+
+		template<typename Fn>
+		void ForEachChild(NodeId id, Fn&& fn) const
+		{
+			for (NodeId child = FirstChild(id); child != InvalidNode; child = NextSibling(child))
+				fn(child);
+		}
+
+		// Folder totals are updated by scan workers while the UI reads them
+		uint64_t Size(NodeId id) const { return std::atomic_ref<uint64_t>(Slot(id).size).load(std::memory_order_relaxed); }
+		void SetSize(NodeId id, uint64_t size) { std::atomic_ref<uint64_t>(Slot(id).size).store(size, std::memory_order_relaxed); }
+
+		// Rewritten by SetChildren whenever the parent folder is read again
+		uint64_t LastChanged(NodeId id) const { return std::atomic_ref<uint64_t>(Slot(id).last_changed).load(std::memory_order_relaxed); }
+		uint32_t EntryCount(NodeId id) const { return std::atomic_ref<uint32_t>(Slot(id).entryCount).load(std::memory_order_relaxed); }
+		bool Listed(NodeId id) const { return std::atomic_ref<uint8_t>(Slot(id).flags).load(std::memory_order_acquire) & NodeFlags_Listed; }
+
+		uint32_t Depth(NodeId id) const
+		{
+			uint32_t depth = 0;
+			for (NodeId parent = Parent(id); parent != InvalidNode; parent = Parent(parent))
+				depth++;
+			return depth;
+		}
+
+		// Rebuilds the full path of `id` into `out` (cleared first). The chain
+		// is walked twice, to measure and then to fill from the end, so there
+		// is no limit on the depth.
+		void BuildPath(NodeId id, std::string& out) const
+		{
+			auto separated = [this](NodeId parent) {
+				if (parent == InvalidNode)
+					return false;
+				std::string_view name = Name(parent);
+				return !name.empty() && name.back() != PATH_SEPARATOR;
+			};
+
+			size_t length = 0;
+			for (NodeId node = id; node != InvalidNode; node = Parent(node))
+				length += Name(node).size() + (separated(Parent(node)) ? 1 : 0);
+
+			out.resize(length);
+			for (NodeId node = id; node != InvalidNode; node = Parent(node))
+			{
+				std::string_view name = Name(node);
+				length -= name.size();
+				memcpy(out.data() + length, name.data(), name.size());
+				if (separated(Parent(node)))
+					out[--length] = PATH_SEPARATOR;
+			}
+		}
+
+		std::string Path(NodeId id) const
+		{
+			std::string path;
+			BuildPath(id, path);
+			return path;
+		}
+
+		NodeId FindChild(NodeId parent, std::string_view name) const
+		{
+			for (NodeId child = FirstChild(parent); child != InvalidNode; child = NextSibling(child))
+			{
+				if (NamesEqual(Name(child), name))
+					return child;
+			}
+			return InvalidNode;
+		}
+
+		std::vector<NodeId> Roots() const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Roots;
+		}
+
+		NodeId FindRoot(std::string_view name) const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (NodeId root : m_Roots)
+			{
+				if (NamesEqual(Name(root), name))
+					return root;
+			}
+			return InvalidNode;
+		}
+
+		// Resolves an absolute path to its node, or InvalidNode if it was never seen.
+		NodeId Find(std::string_view path) const
+		{
+			std::string_view rest;
+			NodeId node = FindRoot(SplitRoot(path, rest));
+			while (node != InvalidNode && !rest.empty())
+				node = FindChild(node, NextComponent(rest));
+			return node;
+		}
+
+		// Like Find, but creates any missing folders along the way.
+		NodeId Intern(std::string_view path)
+		{
+			std::string_view rest;
+			std::string_view rootName = SplitRoot(path, rest);
+			if (rootName.empty())
+				return InvalidNode;
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			NodeId node = InvalidNode;
+			for (NodeId root : m_Roots)
+			{
+				if (NamesEqual(Name(root), rootName))
+				{
+					node = root;
+					break;
+				}
+			}
+
+			if (node == InvalidNode)
+			{
+				node = Allocate(InvalidNode, rootName, EntryKind::Folder);
+				if (node == InvalidNode)
+					return InvalidNode;
+				m_Roots.push_back(node);
+			}
+
+			while (!rest.empty())
+			{
+				std::string_view name = NextComponent(rest);
+				NodeId child = FindChild(node, name);
+				if (child == InvalidNode)
+				{
+					child = Allocate(node, name, EntryKind::Folder);
+					if (child == InvalidNode)
+						return InvalidNode;
+					Link(node, child);
+				}
+				node = child;
+			}
+			return node;
+		}
+
+		// Returns the child called `name`, adding it if the folder doesn't have one.
+		NodeId FindOrAddChild(NodeId parent, std::string_view name, EntryKind kind)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			NodeId child = FindChild(parent, name);
+			if (child == InvalidNode)
+			{
+				child = Allocate(parent, name, kind);
+				if (child != InvalidNode)
+					Link(parent, child);
+			}
+			return child;
+		}
+
+		// FindOrAddChild for a whole batch of names: one lock and one pass over
+		// the existing children, instead of a sibling walk per name.
+		void FindOrAddChildren(NodeId parent, const std::vector<std::string_view>& names, EntryKind kind, std::vector<NodeId>& ids)
+		{
+			ids.resize(names.size());
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			std::unordered_map<std::string_view, NodeId> existing;
+			ForEachChild(parent, [&](NodeId child) {
+				if (Slot(child).kind == kind)
+					existing.emplace(Name(child), child);
+			});
+
+			for (size_t i = 0; i < names.size(); i++)
+			{
+				auto it = existing.find(names[i]);
+				if (it != existing.end())
+				{
+					ids[i] = it->second;
+					continue;
+				}
+
+				ids[i] = Allocate(parent, names[i], kind);
+				if (ids[i] != InvalidNode)
+					Link(parent, ids[i]);
+			}
+		}
+
+		NodeId AddChild(NodeId parent, std::string_view name, EntryKind kind, uint64_t size = 0, uint64_t last_changed = 0)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			NodeId child = Allocate(parent, name, kind);
+			if (child == InvalidNode)
+				return InvalidNode;
+			Slot(child).size = size;
+			Slot(child).last_changed = last_changed;
+			Link(parent, child);
+			return child;
+		}
+
+		// Makes the children of `parent` match `listing`. Entries that were
+		// already known keep their id (so anything keyed by it stays valid),
+		// new ones are added and vanished ones are unlinked. `ids` receives the
+		// node of every listing entry, in listing order (InvalidNode for new
+		// ones once the table is full).
+		void SetChildren(NodeId parent, const DirListing& listing, std::vector<NodeId>& ids)
+		{
+			ids.resize(listing.Size());
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			std::unordered_map<std::string_view, NodeId> existing;
+			if (FirstChild(parent) != InvalidNode)
+			{
+				ForEachChild(parent, [&](NodeId child) {
+					existing.emplace(Name(child), child);
+				});
+			}
+
+			for (size_t i = 0; i < listing.Size(); i++)
+			{
+				const DirEntry& entry = listing.entries[i];
+				std::string_view name = listing.Name(i);
+
+				NodeId id = InvalidNode;
+				if (!existing.empty())
+				{
+					auto it = existing.find(name);
+					if (it != existing.end() && Slot(it->second).kind == entry.kind)
+					{
+						id = it->second;
+						existing.erase(it);
+					}
+				}
+
+				if (id == InvalidNode)
+				{
+					id = Allocate(parent, name, entry.kind);
+					ids[i] = id;
+					if (id == InvalidNode)
+						continue;
+				}
+				else
+					ids[i] = id;
+
+				// Readers don't lock, so these go through atomic_ref like SetSize.
+				// A listing without stat data keeps what the node already had.
+				if (entry.kind == EntryKind::File && (listing.flags & EnumFlags_Size))
+					std::atomic_ref<uint64_t>(Slot(id).size).store(entry.size, std::memory_order_relaxed);
+				if (listing.flags & EnumFlags_Time)
+					std::atomic_ref<uint64_t>(Slot(id).last_changed).store(entry.last_changed, std::memory_order_relaxed);
+			}
+			// What is left vanished; kept so it can come back under its old id
+			if (!existing.empty())
+			{
+				auto& vanished = m_Vanished[parent];
+				for (const auto& [name, id] : existing)
+					vanished[name] = id;
+				m_Unlinked.fetch_add(existing.size(), std::memory_order_relaxed);
+			}
+
+			// Relink in listing order. Unlinked nodes keep their own sibling
+			// pointer, so a reader that is standing on one can still walk on.
+			NodeId first = InvalidNode, last = InvalidNode;
+			for (NodeId id : ids)
+			{
+				if (id == InvalidNode)
+					continue;
+				if (last != InvalidNode)
+					std::atomic_ref<NodeId>(Slot(last).nextSibling).store(id, std::memory_order_release);
+				else
+					first = id;
+				last = id;
+			}
+			if (last != InvalidNode)
+				std::atomic_ref<NodeId>(Slot(last).nextSibling).store(InvalidNode, std::memory_order_release);
+
+			Node& parentNode = Slot(parent);
+			std::atomic_ref<uint32_t>(parentNode.entryCount).store((uint32_t)ids.size(), std::memory_order_relaxed);
+			std::atomic_ref<uint8_t>(parentNode.flags).fetch_or(NodeFlags_Listed, std::memory_order_release);
+			std::atomic_ref<NodeId>(parentNode.firstChild).store(first, std::memory_order_release);
+		}
+
+		// Bytes held by node and name storage, chunk tables included.
+		size_t MemoryUsage() const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			size_t nodeChunks = (Count() + NODE_CHUNK_SIZE - 1) / NODE_CHUNK_SIZE;
+			size_t nameChunks = (m_NamesUsed >> NAME_CHUNK_SHIFT) + 1;
+			size_t vanished = HashMapHeapBytes(m_Vanished);
+			for (const auto& [parent, names] : m_Vanished)
+				vanished += HashMapHeapBytes(names);
+			return nodeChunks * NODE_CHUNK_SIZE * sizeof(Node) + nameChunks * NAME_CHUNK_SIZE
+				+ NODE_CHUNK_COUNT * sizeof(std::atomic<Node*>) + NAME_CHUNK_COUNT * sizeof(std::atomic<char*>) + m_Roots.capacity() * sizeof(NodeId) + vanished;
+		}
+
+		// Path helpers, shared with anything else that walks paths component by component
+		static std::string_view NextComponent(std::string_view& rest)
+		{
+			size_t end = 0;
+			while (end < rest.size() && !IsPathSeparator(rest[end]))
+				end++;
+
+			std::string_view component = rest.substr(0, end);
+			while (end < rest.size() && IsPathSeparator(rest[end]))
+				end++;
+			rest.remove_prefix(end);
+			return component;
+		}
+
+		// Splits "C:\Users\x" into the root "C:" and "Users\x"; "/usr/lib"
+		// into "/" and "usr/lib".
+		static std::string_view SplitRoot(std::string_view path, std::string_view& rest)
+		{
+			size_t rootLength = 0;
+#ifdef _WIN32
+			if (path.size() >= 2 && path[1] == ':')
+				rootLength = 2;
+#else
+			if (!path.empty() && path[0] == '/')
+				rootLength = 1;
+#endif
+			if (rootLength == 0)
+			{
+				rest = std::string_view();
+				return std::string_view();
+			}
+
+			rest = path.substr(rootLength);
+			while (!rest.empty() && IsPathSeparator(rest.front()))
+				rest.remove_prefix(1);
+			while (!rest.empty() && IsPathSeparator(rest.back()))
+				rest.remove_suffix(1);
+			return path.substr(0, rootLength);
+		}
+
+	private:
+		Node& Slot(NodeId id) const
+		{
+			Node* chunk = m_NodeChunks[id >> NODE_CHUNK_SHIFT].load(std::memory_order_acquire);
+			return chunk[id & (NODE_CHUNK_SIZE - 1)];
+		}
+
+		// Reports once that the table stopped growing.
+		NodeId TableFull(const char* what)
+		{
+			if (!m_Full.exchange(true, std::memory_order_relaxed))
+				std::cerr << what << " is full (" << Count() << " nodes, " << UnlinkedCount() << " of them unlinked); new entries are left out until restart\n";
+			return InvalidNode;
+		}
+
+		// The helpers below expect m_Mutex to be held.
+		NodeId Allocate(NodeId parent, std::string_view name, EntryKind kind)
+		{
+			NodeId revived = Revive(parent, name, kind);
+			if (revived != InvalidNode)
+				return revived;
+
+			NodeId id = (NodeId)m_Count.load(std::memory_order_relaxed);
+			size_t chunkIndex = id >> NODE_CHUNK_SHIFT;
+			if (chunkIndex >= NODE_CHUNK_COUNT)
+				return TableFull("NodeTable");
+
+			if (!m_NodeChunks[chunkIndex].load(std::memory_order_relaxed))
+				m_NodeChunks[chunkIndex].store(new Node[NODE_CHUNK_SIZE], std::memory_order_release);
+
+			size_t nameLength = std::min<size_t>(name.size(), 0xFFFF);
+			size_t nameChunk = m_NamesUsed >> NAME_CHUNK_SHIFT;
+			if ((m_NamesUsed & (NAME_CHUNK_SIZE - 1)) + nameLength > NAME_CHUNK_SIZE)
+			{
+				// Names never straddle chunks
+				nameChunk++;
+				if (nameChunk >= NAME_CHUNK_COUNT)
+					return TableFull("NodeTable name pool");
+				m_NamesUsed = (uint64_t)nameChunk << NAME_CHUNK_SHIFT;
+			}
+
+			char* names = m_NameChunks[nameChunk].load(std::memory_order_relaxed);
+			if (!names)
+			{
+				names = new char[NAME_CHUNK_SIZE];
+				m_NameChunks[nameChunk].store(names, std::memory_order_release);
+			}
+			memcpy(names + (m_NamesUsed & (NAME_CHUNK_SIZE - 1)), name.data(), nameLength);
+
+			Node& node = Slot(id);
+			node = Node();
+			node.parent = parent;
+			node.nameOffset = (uint32_t)m_NamesUsed;
+			node.nameLength = (uint16_t)nameLength;
+			node.kind = kind;
+
+			m_NamesUsed += nameLength;
+			m_Count.store(id + 1, std::memory_order_release);
+			return id;
+		}
+
+		// Hands back the slot of an entry that vanished from `parent` under
+		// the same name, emptied like a new one. A folder's old children are
+		// set aside the same way, for when it is listed again.
+		NodeId Revive(NodeId parent, std::string_view name, EntryKind kind)
+		{
+			auto folder = m_Vanished.find(parent);
+			if (folder == m_Vanished.end())
+				return InvalidNode;
+			auto it = folder->second.find(name);
+			if (it == folder->second.end() || Slot(it->second).kind != kind)
+				return InvalidNode;
+
+			NodeId id = it->second;
+			folder->second.erase(it);
+			if (folder->second.empty())
+				m_Vanished.erase(folder);
+			m_Unlinked.fetch_sub(1, std::memory_order_relaxed);
+
+			Node& node = Slot(id);
+			std::atomic_ref<uint64_t>(node.size).store(0, std::memory_order_relaxed);
+			std::atomic_ref<uint64_t>(node.last_changed).store(0, std::memory_order_relaxed);
+			if (FirstChild(id) != InvalidNode)
+			{
+				auto& children = m_Vanished[id];
+				size_t count = 0;
+				ForEachChild(id, [&](NodeId child) {
+					children[Name(child)] = child;
+					count++;
+				});
+				m_Unlinked.fetch_add(count, std::memory_order_relaxed);
+			}
+			std::atomic_ref<NodeId>(node.firstChild).store(InvalidNode, std::memory_order_release);
+			std::atomic_ref<uint32_t>(node.entryCount).store(0, std::memory_order_relaxed);
+			std::atomic_ref<uint8_t>(node.flags).fetch_and((uint8_t)~NodeFlags_Listed, std::memory_order_release);
+			return id;
+		}
+
+		void Link(NodeId parent, NodeId child)
+		{
+			Node& parentNode = Slot(parent);
+			// A revived child may still have a reader standing on it
+			std::atomic_ref<NodeId>(Slot(child).nextSibling).store(parentNode.firstChild, std::memory_order_release);
+			std::atomic_ref<uint32_t>(parentNode.entryCount).fetch_add(1, std::memory_order_relaxed);
+			std::atomic_ref<NodeId>(parentNode.firstChild).store(child, std::memory_order_release);
+		}
+
+		mutable std::mutex m_Mutex;
+		std::vector<NodeId> m_Roots;
+		std::atomic<size_t> m_Count{ 0 };
+		std::atomic<size_t> m_Unlinked{ 0 }; // slots of entries that vanished
+		std::unordered_map<NodeId, std::unordered_map<std::string_view, NodeId>> m_Vanished; // by parent, then name
+		std::atomic<bool> m_Full{ false };
+		uint64_t m_NamesUsed = 0;
+
+		std::unique_ptr<std::atomic<Node*>[]> m_NodeChunks{ new std::atomic<Node*>[NODE_CHUNK_COUNT]() };
+		std::unique_ptr<std::atomic<char*>[]> m_NameChunks{ new std::atomic<char*>[NAME_CHUNK_COUNT]() };
+	};
+
+}
\ No newline at end of file
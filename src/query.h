@@ -0,0 +1,361 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "enumerate.h"
+#include "matcher.h"
+#include "rank.h"
+
+namespace File {
+
+	// Lower-cased extension packed into an integer so the `ext:` check is a
+	// compare instead of a string match. 0 means none or longer than 8 bytes.
+	static uint64_t PackExtension(std::string_view name)
+	{
+		size_t dot = name.find_last_of('.');
+		if (dot == std::string_view::npos || name.size() - dot - 1 > 8)
+			return 0;
+
+		uint64_t packed = 0;
+		for (size_t i = dot + 1; i < name.size(); i++)
+			packed = (packed << 8) | (unsigned char)FoldChar(name[i]);
+		return packed;
+	}
+
+	static uint64_t NowFileTime()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() * 10000000ULL + FILETIME_UNIX_EPOCH;
+	}
+
+	// A compiled search such as `ext:log,txt size:>1G modified:<30d path:build foo`.
+	//
+	//   ext:a,b        extension is one of these (files only)
+	//   size:>1G       also >=, <, <=, =, and ranges like 10M..1G (K/M/G/T are 1024-based)
+	//   modified:<30d  age in h/d/w/m/y; < is newer than, > is older than. Also yyyy-mm-dd
+	//   path:text      the containing folder's path contains text
+	//   kind:file      or kind:folder
+	//
+	// Anything else is a name term (unknown keys too, so "12:30" is searched
+	// for as is), and every term has to match: as a substring, or in fuzzy
+	// mode as a subsequence. Checks run cheapest
+	// first: kind, extension, size and date come straight from the
+	// enumeration record, then the name terms, and the path last.
+	class SearchQuery {
+	public:
+		// Returns false with `error` set if `text` doesn't parse.
+		bool Compile(std::string_view text, std::string& error, bool fuzzy = false)
+		{
+			*this = SearchQuery();
+			m_Fuzzy = fuzzy;
+			uint64_t now = NowFileTime();
+
+			while (!text.empty())
+			{
+				size_t start = text.find_first_not_of(' ');
+				if (start == std::string_view::npos)
+					break;
+				text.remove_prefix(start);
+				size_t end = text.find(' ');
+				std::string_view token = text.substr(0, end);
+				text.remove_prefix(end == std::string_view::npos ? text.size() : end);
+
+				size_t colon = token.find(':');
+				std::string_view key = colon == std::string_view::npos ? std::string_view() : token.substr(0, colon);
+				std::string_view value = colon == std::string_view::npos ? token : token.substr(colon + 1);
+
+				if (key == "ext")
+				{
+					while (!value.empty())
+					{
+						size_t comma = value.find(',');
+						std::string_view ext = value.substr(0, comma);
+						value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+						if (!ext.empty() && ext.front() == '.')
+							ext.remove_prefix(1);
+
+						uint64_t packed = ext.empty() ? 0 : PackExtension("." + std::string(ext));
+						if (packed == 0)
+						{
+							error = "ext: needs extensions of 1 to 8 characters";
+							return false;
+						}
+						m_Extensions.push_back(packed);
+					}
+				}
+				else if (key == "size")
+				{
+					if (!ParseRange(value, m_MinSize, m_MaxSize, [](std::string_view text, uint64_t& size) { return ParseSize(text, size); }))
+					{
+						error = "Can't read size filter '" + std::string(value) + "'";
+						return false;
+					}
+				}
+				else if (key == "modified")
+				{
+					if (!ParseModified(value, now, m_ChangedAfter, m_ChangedBefore))
+					{
+						error = "Can't read date filter '" + std::string(value) + "'";
+						return false;
+					}
+				}
+				else if (key == "path")
+				{
+					if (!value.empty())
+						m_PathTerms.emplace_back(value);
+				}
+				else if (key == "kind")
+				{
+					if (value == "file")
+						m_Kind = EntryKind::File;
+					else if (value == "folder")
+						m_Kind = EntryKind::Folder;
+					else
+					{
+						error = "kind: is file or folder";
+						return false;
+					}
+					m_HasKind = true;
+				}
+				else
+					m_NameTerms.emplace_back(token);
+			}
+
+			return true;
+		}
+
+		bool Fuzzy() const { return m_Fuzzy; }
+		bool HasPathTerms() const { return !m_PathTerms.empty(); }
+		bool HasSize() const { return m_MinSize != 0 || m_MaxSize != UINT64_MAX; }
+		bool HasDate() const { return m_ChangedAfter != 0 || m_ChangedBefore != UINT64_MAX; }
+
+		// What a directory listing has to stat for every entry: only what the
+		// size and date filters look at.
+		uint32_t EnumFlags() const { return (HasSize() ? EnumFlags_Size : EnumFlags_None) | (HasDate() ? EnumFlags_Time : EnumFlags_None); }
+
+		// The name term with the most trigrams, for the name index to look up;
+		// empty if there are no name terms or they are fuzzy.
+		std::string_view LongestNameTerm() const
+		{
+			std::string_view longest;
+			if (m_Fuzzy)
+				return longest;
+			for (const NameMatcher& term : m_NameTerms)
+			{
+				if (term.Query().size() > longest.size())
+					longest = term.Query();
+			}
+			return longest;
+		}
+
+		// The path predicate, evaluated once per folder rather than per entry.
+		bool MatchesDirectory(std::string_view path) const
+		{
+			for (const NameMatcher& term : m_PathTerms)
+			{
+				if (!term.Matches(path))
+					return false;
+			}
+			return true;
+		}
+
+		// Everything except the path. `size` is ignored for folders whose size
+		// isn't known (`sizeKnown` false); they fail a size filter. A match
+		// sets `nameScore`, how well the name terms fit, for Score.
+		bool MatchesEntry(EntryKind kind, std::string_view name, uint64_t size, bool sizeKnown, uint64_t last_changed, int& nameScore) const
+		{
+			if (m_HasKind && kind != m_Kind)
+				return false;
+
+			if (!m_Extensions.empty())
+			{
+				if (kind != EntryKind::File)
+					return false;
+				uint64_t packed = PackExtension(name);
+				bool found = false;
+				for (uint64_t extension : m_Extensions)
+					found |= extension == packed;
+				if (!found)
+					return false;
+			}
+
+			if (HasSize() && (!sizeKnown || size < m_MinSize || size > m_MaxSize))
+				return false;
+
+			if (last_changed < m_ChangedAfter || last_changed > m_ChangedBefore)
+				return false;
+
+			// In fuzzy mode the score is the match, so each term is scored once
+			nameScore = 0;
+			for (const NameMatcher& term : m_NameTerms)
+			{
+				if (!m_Fuzzy && !term.Matches(name))
+					return false;
+				int termScore = FuzzyScore(name, term.Query());
+				if (m_Fuzzy && termScore < 0)
+					return false;
+				nameScore += std::max(0, termScore);
+			}
+			return true;
+		}
+
+		// Ranks an entry that matched: the name score from MatchesEntry, plus
+		// a little for being shallow and for having changed recently.
+		int Score(int nameScore, uint32_t depth, uint64_t last_changed, uint64_t now) const
+		{
+			int score = nameScore;
+			score += std::max(0, 20 - 2 * (int)depth);
+
+			const uint64_t ticksPerDay = 86400ULL * 10000000ULL;
+			uint64_t age = now > last_changed ? now - last_changed : 0;
+			if (age < ticksPerDay)
+				score += 15;
+			else if (age < 7 * ticksPerDay)
+				score += 10;
+			else if (age < 30 * ticksPerDay)
+				score += 5;
+			return score;
+		}
+
+	private:
+		template<typename Parse>
+		static bool ParseRange(std::string_view text, uint64_t& min, uint64_t& max, Parse&& parse)
+		{
+			uint64_t value;
+			size_t dots = text.find("..");
+			if (dots != std::string_view::npos)
+			{
+				uint64_t high;
+				if (!parse(text.substr(0, dots), value) || !parse(text.substr(dots + 2), high))
+					return false;
+				min = value;
+				max = high;
+				return true;
+			}
+
+			if (text.substr(0, 2) == ">=") { if (!parse(text.substr(2), value)) return false; min = value; }
+			else if (text.substr(0, 2) == "<=") { if (!parse(text.substr(2), value)) return false; max = value; }
+			else if (text.substr(0, 1) == ">") { if (!parse(text.substr(1), value)) return false; min = value + 1; }
+			else if (text.substr(0, 1) == "<") { if (!parse(text.substr(1), value) || value == 0) return false; max = value - 1; }
+			else
+			{
+				if (!parse(text.substr(text.substr(0, 1) == "=" ? 1 : 0), value))
+					return false;
+				min = max = value;
+			}
+			return true;
+		}
+
+		static bool ParseNumber(std::string_view& text, double& number)
+		{
+			std::string digits(text);
+			char* end = nullptr;
+			number = strtod(digits.c_str(), &end);
+			if (end == digits.c_str() || number < 0)
+				return false;
+			text.remove_prefix(end - digits.c_str());
+			return true;
+		}
+
+		static bool ParseSize(std::string_view text, uint64_t& size)
+		{
+			double number;
+			if (!ParseNumber(text, number))
+				return false;
+
+			double scale = 1.0;
+			if (!text.empty())
+			{
+				switch (FoldChar(text.front()))
+				{
+				case 'b': break;
+				case 'k': scale = 1024.0; break;
+				case 'm': scale = 1024.0 * 1024; break;
+				case 'g': scale = 1024.0 * 1024 * 1024; break;
+				case 't': scale = 1024.0 * 1024 * 1024 * 1024; break;
+				default: return false;
+				}
+				text.remove_prefix(1);
+				if (!text.empty() && FoldChar(text.front()) == 'b')
+					text.remove_prefix(1);
+			}
+			size = (uint64_t)(number * scale);
+			return text.empty();
+		}
+
+		// modified:<30d (newer than 30 days), modified:>1y (older than a year),
+		// modified:<2024-01-31 (before that day), modified:>=2024-01-31
+		static bool ParseModified(std::string_view text, uint64_t now, uint64_t& after, uint64_t& before)
+		{
+			bool less = !text.empty() && text[0] == '<';
+			if (text.empty() || (text[0] != '<' && text[0] != '>'))
+				return false;
+			bool inclusive = text.size() > 1 && text[1] == '=';
+			text.remove_prefix(inclusive ? 2 : 1);
+
+			const uint64_t ticksPerDay = 86400ULL * 10000000ULL;
+			int year, month, dayOfMonth;
+			if (text.size() == 10 && sscanf(std::string(text).c_str(), "%4d-%2d-%2d", &year, &month, &dayOfMonth) == 3)
+			{
+				// Days since 1970 of a Gregorian date (Howard Hinnant's days_from_civil)
+				year -= month <= 2;
+				int era = (year >= 0 ? year : year - 399) / 400;
+				unsigned yearOfEra = (unsigned)(year - era * 400);
+				unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + dayOfMonth - 1;
+				unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+				int64_t days = (int64_t)era * 146097 + dayOfEra - 719468;
+				if (days < 0 || month < 1 || month > 12 || dayOfMonth < 1 || dayOfMonth > 31)
+					return false;
+
+				// The date covers the whole day
+				uint64_t dayStart = (uint64_t)days * ticksPerDay + FILETIME_UNIX_EPOCH;
+				if (less)
+					before = (inclusive ? dayStart + ticksPerDay : dayStart) - 1;
+				else
+					after = inclusive ? dayStart : dayStart + ticksPerDay;
+				return true;
+			}
+
+			double number;
+			if (!ParseNumber(text, number) || text.size() != 1)
+				return false;
+
+			double hours;
+			switch (FoldChar(text.front()))
+			{
+			case 'h': hours = 1; break;
+			case 'd': hours = 24; break;
+			case 'w': hours = 24 * 7; break;
+			case 'm': hours = 24 * 30; break;
+			case 'y': hours = 24 * 365; break;
+			default: return false;
+			}
+
+			// An age: "less than" means changed more recently than now - age
+			uint64_t age = (uint64_t)(number * hours * 3600.0 * 10000000.0);
+			uint64_t moment = age < now ? now - age : 0;
+			if (less)
+				after = moment;
+			else
+				before = moment;
+			return true;
+		}
+
+		std::vector<NameMatcher> m_NameTerms;
+		std::vector<NameMatcher> m_PathTerms;
+		std::vector<uint64_t> m_Extensions;
+		uint64_t m_MinSize = 0;
+		uint64_t m_MaxSize = UINT64_MAX;
+		uint64_t m_ChangedAfter = 0;
+		uint64_t m_ChangedBefore = UINT64_MAX;
+		EntryKind m_Kind = EntryKind::File;
+		bool m_HasKind = false;
+		bool m_Fuzzy = false;
+	};
+
+}
\ No newline at end of file
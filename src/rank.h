@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "executor.h"
+#include "nametable.h"
+
+namespace File {
+
+	static inline bool IsWordStart(std::string_view name, size_t i)
+	{
+		if (i == 0)
+			return true;
+
+		char previous = name[i - 1];
+		char current = name[i];
+		if (previous == ' ' || previous == '_' || previous == '-' || previous == '.' || previous == '(' || previous == '[')
+			return true;
+		if (previous >= 'a' && previous <= 'z' && current >= 'A' && current <= 'Z')
+			return true;
+		return !(previous >= '0' && previous <= '9') && current >= '0' && current <= '9';
+	}
+
+	// How well `name` matches a folded query, or -1 if the query's characters
+	// don't all appear in it in order. A contiguous match scores far above a
+	// scattered one; starting at a word boundary or the start of the name,
+	// runs of consecutive characters and short gaps all add to it.
+	static int FuzzyScore(std::string_view name, std::string_view folded)
+	{
+		if (folded.empty())
+			return 0;
+		if (name.size() < folded.size())
+			return -1;
+
+		// Best contiguous occurrence, if any
+		int best = -1;
+		for (size_t pos = 0; pos + folded.size() <= name.size(); pos++)
+		{
+			size_t i = 0;
+			while (i < folded.size() && FoldChar(name[pos + i]) == folded[i])
+				i++;
+			if (i < folded.size())
+				continue;
+
+			int score = 100 + 10 * (int)folded.size();
+			if (pos == 0)
+				score += 30;
+			else if (IsWordStart(name, pos))
+				score += 20;
+			if (pos + folded.size() == name.size() || name[pos + folded.size()] == '.')
+				score += 10; // the whole stem
+			score -= (int)std::min<size_t>(pos, 10);
+			best = std::max(best, score);
+		}
+		if (best >= 0)
+			return best;
+
+		// Greedy subsequence
+		int score = 0;
+		size_t next = 0;
+		size_t previous = std::string_view::npos;
+		for (size_t i = 0; i < name.size() && next < folded.size(); i++)
+		{
+			if (FoldChar(name[i]) != folded[next])
+				continue;
+
+			score += 10;
+			if (previous != std::string_view::npos && previous + 1 == i)
+				score += 15;
+			else if (previous != std::string_view::npos)
+				score -= (int)std::min<size_t>(i - previous - 1, 5);
+			if (IsWordStart(name, i))
+				score += 20;
+			previous = i;
+			next++;
+		}
+		return next == folded.size() ? std::max(score, 1) : -1;
+	}
+
+	// Keeps the K highest scoring items seen, in a min-heap so a new item
+	// only has to beat the current K-th best.
+	template<typename T>
+	class TopK {
+	public:
+		using Item = std::pair<int, T>;
+
+		explicit TopK(size_t capacity = 0) : m_Capacity(capacity) {}
+
+		void Reset(size_t capacity)
+		{
+			m_Capacity = capacity;
+			m_Heap.clear();
+		}
+
+		size_t Size() const { return m_Heap.size(); }
+
+		// Cheap check before building an item that wouldn't be kept
+		bool Accepts(int score) const { return m_Heap.size() < m_Capacity || (m_Capacity > 0 && score > m_Heap.front().first); }
+
+		void Push(int score, T value)
+		{
+			Push(score, std::move(value), [](Item&&) {});
+		}
+
+		// Like Push, but hands the item it displaces, if any, to onEvict.
+		// Returns whether the new item was kept.
+		template<typename OnEvict>
+		bool Push(int score, T value, OnEvict&& onEvict)
+		{
+			if (!Accepts(score))
+				return false;
+
+			if (m_Heap.size() == m_Capacity)
+			{
+				std::pop_heap(m_Heap.begin(), m_Heap.end(), Greater);
+				onEvict(std::move(m_Heap.back()));
+				m_Heap.pop_back();
+			}
+			m_Heap.emplace_back(score, std::move(value));
+			std::push_heap(m_Heap.begin(), m_Heap.end(), Greater);
+			return true;
+		}
+
+		const std::vector<Item>& Items() const { return m_Heap; }
+
+		// Best first; leaves the heap empty.
+		std::vector<Item> TakeSorted()
+		{
+			std::vector<Item> items = std::move(m_Heap);
+			m_Heap.clear();
+			std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.first > b.first; });
+			return items;
+		}
+
+	private:
+		static bool Greater(const Item& a, const Item& b) { return a.first > b.first; }
+
+		size_t m_Capacity;
+		std::vector<Item> m_Heap;
+	};
+
+	// Just the scores of a TopK: enough to answer Accepts without keeping
+	// copies of the items themselves.
+	class TopScores {
+	public:
+		explicit TopScores(size_t capacity = 0) : m_Capacity(capacity) {}
+
+		bool Accepts(int score) const { return m_Heap.size() < m_Capacity || (m_Capacity > 0 && score > m_Heap.front()); }
+
+		// Returns whether the score was kept.
+		bool Push(int score)
+		{
+			if (!Accepts(score))
+				return false;
+
+			if (m_Heap.size() == m_Capacity)
+			{
+				std::pop_heap(m_Heap.begin(), m_Heap.end(), std::greater<int>());
+				m_Heap.pop_back();
+			}
+			m_Heap.push_back(score);
+			std::push_heap(m_Heap.begin(), m_Heap.end(), std::greater<int>());
+			return true;
+		}
+
+	private:
+		size_t m_Capacity;
+		std::vector<int> m_Heap;
+	};
+
+	// Streaming top K fed by many threads and read by one. Each pool worker
+	// owns a slot: the scores of its own best K, used without a lock to drop
+	// items that can't make it, and a SegmentQueue that publishes the ones
+	// that do (so each item is copied once, into the queue).
+	// The consumer (the UI, once per frame) drains every queue into its own
+	// TopK, which is exactly the global best K. Threads outside the pool
+	// share the last slot behind a mutex.
+	template<typename T>
+	class WorkerTopK {
+	public:
+		using Item = std::pair<int, T>;
+
+		// What one Drain changed in the merged top K: the items that entered
+		// it, each with an id unique to this WorkerTopK, and the ids of the
+		// items pushed out (which may include some of those just added).
+		struct Delta {
+			std::vector<std::pair<uint64_t, Item>> added;
+			std::vector<uint64_t> evicted;
+		};
+
+		WorkerTopK(size_t workers, size_t capacity)
+			: m_Merged(capacity)
+		{
+			for (size_t i = 0; i < workers + 1; i++)
+				m_Slots.push_back(std::make_unique<Slot>(capacity));
+		}
+
+		// The slot for a worker index; anything else shares the last one.
+		size_t SlotFor(size_t worker) const { return std::min(worker, m_Slots.size() - 1); }
+
+		void Push(size_t slot, int score, T value)
+		{
+			Offer(slot, score, [&value]() { return std::move(value); });
+		}
+
+		// Like Push, but only builds the item (make()) if it makes the cut.
+		template<typename Make>
+		void Offer(size_t slot, int score, Make&& make)
+		{
+			m_Matches.fetch_add(1, std::memory_order_relaxed);
+			Slot& s = *m_Slots[slot];
+
+			std::unique_lock<std::mutex> lock;
+			if (slot == m_Slots.size() - 1)
+				lock = std::unique_lock<std::mutex>(m_OutsideMutex);
+
+			if (!s.scores.Push(score))
+				return;
+			s.queue.Push({ score, make() });
+			m_Published.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Makes the next Drain report a change, e.g. after a result's size changed
+		void Touch() { m_Touched.store(true, std::memory_order_release); }
+
+		uint64_t Matches() const { return m_Matches.load(std::memory_order_relaxed); }
+		uint64_t Published() const { return m_Published.load(std::memory_order_relaxed); }
+
+		// Consumer only: the rest are read by whoever calls Drain.
+		uint64_t Drained() const { return m_Drained; }
+		uint64_t Segments() const
+		{
+			uint64_t segments = 0;
+			for (const auto& slot : m_Slots)
+				segments += slot->queue.SegmentCount();
+			return segments;
+		}
+
+		// Consumer only. Moves everything published into the merged top K and,
+		// given a delta, records what that changed; returns whether anything
+		// changed since the last call.
+		bool Drain(Delta* delta = nullptr)
+		{
+			size_t drained = 0;
+			for (const auto& slot : m_Slots)
+			{
+				drained += slot->queue.Drain([this, delta](Item&& item) {
+					uint64_t id = m_NextId++;
+					bool kept = m_Merged.Push(item.first, { id, delta ? item.second : std::move(item.second) }, [delta](auto&& evicted) {
+						if (delta)
+							delta->evicted.push_back(evicted.second.first);
+					});
+					if (kept && delta)
+						delta->added.emplace_back(id, std::move(item));
+				});
+			}
+			m_Drained += drained;
+			return drained > 0 || m_Touched.exchange(false, std::memory_order_acq_rel);
+		}
+
+		// Consumer only. The best K drained so far, best first.
+		std::vector<Item> Best() const
+		{
+			TopK<Tagged> copy = m_Merged;
+			std::vector<Item> best;
+			for (auto& [score, tagged] : copy.TakeSorted())
+				best.emplace_back(score, std::move(tagged.second));
+			return best;
+		}
+
+	private:
+		using Tagged = std::pair<uint64_t, T>;
+
+		struct alignas(64) Slot {
+			explicit Slot(size_t capacity) : scores(capacity) {}
+			TopScores scores;
+			SegmentQueue<Item> queue;
+		};
+
+		std::vector<std::unique_ptr<Slot>> m_Slots;
+		std::mutex m_OutsideMutex;
+		std::atomic<uint64_t> m_Matches{ 0 };
+		std::atomic<uint64_t> m_Published{ 0 };
+		std::atomic<bool> m_Touched{ false };
+
+		TopK<Tagged> m_Merged;
+		uint64_t m_Drained = 0;
+		uint64_t m_NextId = 0;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,637 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "nodes.h"
+
+#define SNAPSHOT_FILE "folder_sizes.bin"
+#define SNAPSHOT_MAGIC "EXPSIZES"
+#define SNAPSHOT_VERSION 3 // 3: sub folders sorted by name (CompareNames)
+
+namespace File {
+
+	// Read-only view of a whole file. Pages are only read in when touched.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile() { Close(); }
+
+		bool Open(const std::string& path)
+		{
+			Close();
+#ifdef _WIN32
+			m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_File == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+			{
+				Close();
+				return false;
+			}
+
+			m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_Mapping)
+			{
+				Close();
+				return false;
+			}
+
+			m_Data = (const uint8_t*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+			m_Size = (size_t)size.QuadPart;
+#else
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				return false;
+
+			struct stat st;
+			if (fstat(fd, &st) != 0 || st.st_size == 0)
+			{
+				close(fd);
+				return false;
+			}
+
+			void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd); // the mapping keeps the file alive
+			if (data == MAP_FAILED)
+				return false;
+
+			m_Data = (const uint8_t*)data;
+			m_Size = (size_t)st.st_size;
+#endif
+			if (!m_Data)
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+#ifdef _WIN32
+			if (m_Data)
+				UnmapViewOfFile(m_Data);
+			if (m_Mapping)
+				CloseHandle(m_Mapping);
+			if (m_File != INVALID_HANDLE_VALUE)
+				CloseHandle(m_File);
+			m_Mapping = nullptr;
+			m_File = INVALID_HANDLE_VALUE;
+#else
+			if (m_Data)
+				munmap((void*)m_Data, m_Size);
+#endif
+			m_Data = nullptr;
+			m_Size = 0;
+		}
+
+		const uint8_t* Data() const { return m_Data; }
+		size_t Size() const { return m_Size; }
+
+	private:
+#ifdef _WIN32
+		HANDLE m_File = INVALID_HANDLE_VALUE;
+		HANDLE m_Mapping = nullptr;
+#endif
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+
+	// Writes `path` through a temporary file that is flushed and then renamed
+	// over it, so readers see either the old file or the complete new one.
+	static bool WriteFileAtomic(const std::string& path, const std::vector<std::string_view>& parts)
+	{
+		std::string temp = path + ".tmp";
+		bool ok = true;
+#ifdef _WIN32
+		HANDLE file = CreateFileA(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		for (std::string_view part : parts)
+		{
+			size_t written = 0;
+			while (ok && written < part.size())
+			{
+				DWORD chunk = (DWORD)std::min<size_t>(part.size() - written, 1u << 30);
+				DWORD done = 0;
+				ok = WriteFile(file, part.data() + written, chunk, &done, nullptr) && done > 0;
+				written += done;
+			}
+		}
+		ok = ok && FlushFileBuffers(file);
+		CloseHandle(file);
+
+		ok = ok && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			return false;
+
+		for (std::string_view part : parts)
+		{
+			size_t written = 0;
+			while (ok && written < part.size())
+			{
+				ssize_t done = write(fd, part.data() + written, part.size() - written);
+				ok = done > 0;
+				written += ok ? (size_t)done : 0;
+			}
+		}
+		ok = ok && fsync(fd) == 0;
+		close(fd);
+
+		ok = ok && rename(temp.c_str(), path.c_str()) == 0;
+#endif
+		if (!ok)
+			std::remove(temp.c_str());
+		return ok;
+	}
+
+	// Cheap 64-bit checksum, a word at a time so verifying a large snapshot
+	// costs about as much as reading it.
+	static uint64_t Checksum64(const uint8_t* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+	{
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			hash = (hash ^ word) * 0x100000001b3ULL;
+			hash ^= hash >> 29;
+		}
+		for (; i < size; i++)
+			hash = (hash ^ data[i]) * 0x100000001b3ULL;
+		return hash;
+	}
+
+	// On-disk layout: header, `nodeCount` SnapshotNodes, then the name pool.
+	// Everything is little-endian and read in place.
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint64_t created; // FILETIME ticks
+		uint32_t nodeCount;
+		uint32_t rootCount; // roots are the first `rootCount` nodes
+		uint64_t namesSize;
+		uint64_t checksum; // of everything after the header
+	};
+	static_assert(sizeof(SnapshotHeader) == 48, "SnapshotHeader is part of the file format");
+
+	enum SnapshotFlags : uint8_t {
+		SnapshotFlags_None = 0,
+		SnapshotFlags_SizeKnown = 1 << 0,
+		SnapshotFlags_Listed = 1 << 1, // entryCount is valid
+		SnapshotFlags_Scanned = 1 << 2, // filesSize and last_changed are valid
+	};
+
+	using SnapshotIndex = uint32_t;
+	constexpr SnapshotIndex InvalidSnapshotIndex = 0xFFFFFFFF;
+
+	// One folder. Nodes are stored breadth first, so the children of a folder
+	// are the range [firstChild, firstChild + childCount).
+	struct SnapshotNode {
+		uint64_t size;
+		uint64_t filesSize; // the folder's own files, without sub folders
+		uint64_t last_changed; // folder mtime when it was last read
+		SnapshotIndex parent;
+		SnapshotIndex firstChild;
+		uint32_t childCount;
+		uint32_t entryCount;
+		uint32_t nameOffset;
+		uint16_t nameLength;
+		uint8_t flags;
+		uint8_t reserved;
+	};
+	static_assert(sizeof(SnapshotNode) == 48, "SnapshotNode is part of the file format");
+
+	// What the running session knows about one folder, handed to Save.
+	struct LiveFolder {
+		bool sizeKnown = false;
+		uint64_t size = 0;
+		bool scanned = false;
+		uint64_t filesSize = 0;
+		uint64_t last_changed = 0;
+	};
+
+	// Folder sizes of earlier sessions. The file is mapped and used in place;
+	// Save merges the live NodeTable into it and swaps the file atomically.
+	class SizeSnapshot {
+	public:
+		bool Load(const std::string& path)
+		{
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+			m_Path = path;
+			return Map();
+		}
+
+		void Close()
+		{
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+			Unmap();
+		}
+
+		bool Loaded() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_Header != nullptr;
+		}
+
+		uint32_t NodeCount() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_Header ? m_Header->nodeCount : 0;
+		}
+
+		size_t FileSize() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_File.Size();
+		}
+
+		// Time spent mapping/validating the file, and checksumming it
+		double MapMilliseconds() const { return m_MapMs; }
+		double VerifyMilliseconds() const { return m_VerifyMs; }
+
+		bool FindSize(std::string_view path, uint64_t& size) const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			SnapshotIndex index = Find(path);
+			if (index == InvalidSnapshotIndex || !(m_Nodes[index].flags & SnapshotFlags_SizeKnown))
+				return false;
+
+			size = m_Nodes[index].size;
+			return true;
+		}
+
+		// Calls onFolder(node) for `path` and, if that returns true, onChild(name,
+		// node) for each of its sub folders. Returns onFolder's answer.
+		template<typename FolderFn, typename ChildFn>
+		bool VisitFolder(std::string_view path, FolderFn&& onFolder, ChildFn&& onChild) const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			SnapshotIndex index = Find(path);
+			if (index == InvalidSnapshotIndex)
+				return false;
+
+			const SnapshotNode& folder = m_Nodes[index];
+			if (!onFolder(folder))
+				return false;
+
+			for (uint32_t i = 0; i < folder.childCount; i++)
+			{
+				const SnapshotNode& child = m_Nodes[folder.firstChild + i];
+				onChild(Name(child), child);
+			}
+			return true;
+		}
+
+		// Calls fn(name, node) for every sub folder the snapshot has for `path`.
+		template<typename Fn>
+		void ForEachChild(std::string_view path, Fn&& fn) const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			SnapshotIndex index = Find(path);
+			if (index == InvalidSnapshotIndex)
+				return;
+
+			const SnapshotNode& folder = m_Nodes[index];
+			for (uint32_t i = 0; i < folder.childCount; i++)
+			{
+				const SnapshotNode& child = m_Nodes[folder.firstChild + i];
+				fn(Name(child), child);
+			}
+		}
+
+		// Writes every folder of `nodes` (with what `describe` knows about it)
+		// merged with the folders of the current file not seen this session.
+		bool Save(const NodeTable& nodes, const std::function<void(NodeId, LiveFolder&)>& describe)
+		{
+			std::lock_guard<std::mutex> saveLock(m_SaveMutex);
+
+			std::vector<SnapshotNode> out;
+			std::string names;
+			uint32_t rootCount = 0;
+			{
+				std::shared_lock<std::shared_mutex> lock(m_Mutex);
+				rootCount = Merge(nodes, describe, out, names);
+			}
+
+			SnapshotHeader header = {};
+			memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+			header.version = SNAPSHOT_VERSION;
+			header.headerSize = sizeof(SnapshotHeader);
+			header.created = (uint64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() * 10000000ULL + FILETIME_UNIX_EPOCH;
+			header.nodeCount = (uint32_t)out.size();
+			header.rootCount = rootCount;
+			header.namesSize = names.size();
+			header.checksum = Checksum64((const uint8_t*)out.data(), out.size() * sizeof(SnapshotNode));
+			header.checksum = Checksum64((const uint8_t*)names.data(), names.size(), header.checksum);
+
+			std::string_view headerBytes((const char*)&header, sizeof(header));
+			std::string_view nodeBytes((const char*)out.data(), out.size() * sizeof(SnapshotNode));
+
+			// The mapped file can't be replaced while it is mapped (on Windows)
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+			Unmap();
+			bool ok = WriteFileAtomic(m_Path, { headerBytes, nodeBytes, names });
+			if (!ok)
+				std::cerr << "Failed to write " << m_Path << "\n";
+			Map();
+			return ok;
+		}
+
+	private:
+		// Everything below expects m_Mutex to be held.
+		bool Map()
+		{
+			Unmap();
+
+			auto start = std::chrono::steady_clock::now();
+			if (!m_File.Open(m_Path))
+				return false;
+
+			const uint8_t* data = m_File.Data();
+			size_t size = m_File.Size();
+
+			const SnapshotHeader* header = (const SnapshotHeader*)data;
+			if (size < sizeof(SnapshotHeader) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 || header->headerSize != sizeof(SnapshotHeader))
+			{
+				std::cerr << m_Path << " is not a folder size snapshot\n";
+				m_File.Close();
+				return false;
+			}
+			if (header->version != SNAPSHOT_VERSION)
+			{
+				std::cerr << m_Path << " has version " << header->version << ", expected " << SNAPSHOT_VERSION << "\n";
+				m_File.Close();
+				return false;
+			}
+
+			uint64_t payload = (uint64_t)header->nodeCount * sizeof(SnapshotNode) + header->namesSize;
+			if (header->rootCount > header->nodeCount || size - sizeof(SnapshotHeader) != payload)
+			{
+				std::cerr << m_Path << " is truncated\n";
+				m_File.Close();
+				return false;
+			}
+			auto mapped = std::chrono::steady_clock::now();
+
+			if (Checksum64(data + sizeof(SnapshotHeader), (size_t)payload) != header->checksum)
+			{
+				std::cerr << m_Path << " failed its checksum\n";
+				m_File.Close();
+				return false;
+			}
+			auto verified = std::chrono::steady_clock::now();
+
+			m_Header = header;
+			m_Nodes = (const SnapshotNode*)(data + sizeof(SnapshotHeader));
+			m_Names = (const char*)(m_Nodes + header->nodeCount);
+			m_MapMs = std::chrono::duration<double, std::milli>(mapped - start).count();
+			m_VerifyMs = std::chrono::duration<double, std::milli>(verified - mapped).count();
+			return true;
+		}
+
+		void Unmap()
+		{
+			m_File.Close();
+			m_Header = nullptr;
+			m_Nodes = nullptr;
+			m_Names = nullptr;
+		}
+
+		std::string_view Name(const SnapshotNode& node) const { return std::string_view(m_Names + node.nameOffset, node.nameLength); }
+
+		SnapshotIndex FindChild(SnapshotIndex parent, std::string_view name) const
+		{
+			const SnapshotNode& folder = m_Nodes[parent];
+			uint32_t low = 0, high = folder.childCount;
+			while (low < high)
+			{
+				uint32_t middle = low + (high - low) / 2;
+				int order = CompareNames(Name(m_Nodes[folder.firstChild + middle]), name);
+				if (order == 0)
+					return folder.firstChild + middle;
+				if (order < 0)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+			return InvalidSnapshotIndex;
+		}
+
+		// Sorts the children Merge just appended from `first` on by name,
+		// keeping `sources` in step. Their own children aren't placed yet.
+		static void SortChildren(std::vector<SnapshotNode>& out, std::vector<std::pair<NodeId, SnapshotIndex>>& sources, const std::string& names, size_t first)
+		{
+			size_t count = out.size() - first;
+			if (count < 2)
+				return;
+
+			auto name = [&names](const SnapshotNode& node) { return std::string_view(names.data() + node.nameOffset, node.nameLength); };
+			std::vector<size_t> order(count);
+			for (size_t i = 0; i < count; i++)
+				order[i] = first + i;
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return CompareNames(name(out[a]), name(out[b])) < 0; });
+
+			std::vector<SnapshotNode> sortedNodes;
+			std::vector<std::pair<NodeId, SnapshotIndex>> sortedSources;
+			sortedNodes.reserve(count);
+			sortedSources.reserve(count);
+			for (size_t index : order)
+			{
+				sortedNodes.push_back(out[index]);
+				sortedSources.push_back(sources[index]);
+			}
+			std::copy(sortedNodes.begin(), sortedNodes.end(), out.begin() + first);
+			std::copy(sortedSources.begin(), sortedSources.end(), sources.begin() + first);
+		}
+
+		SnapshotIndex Find(std::string_view path) const
+		{
+			if (!m_Header)
+				return InvalidSnapshotIndex;
+
+			std::string_view rest;
+			std::string_view rootName = NodeTable::SplitRoot(path, rest);
+
+			SnapshotIndex index = InvalidSnapshotIndex;
+			for (SnapshotIndex root = 0; root < m_Header->rootCount; root++)
+			{
+				if (NamesEqual(Name(m_Nodes[root]), rootName))
+				{
+					index = root;
+					break;
+				}
+			}
+
+			while (index != InvalidSnapshotIndex && !rest.empty())
+				index = FindChild(index, NodeTable::NextComponent(rest));
+			return index;
+		}
+
+		// Breadth first over the live tree and the mapped one side by side. A
+		// folder the live tree has listed is authoritative for its children;
+		// one it has only passed through keeps the children it had on disk.
+		// Returns the number of roots.
+		uint32_t Merge(const NodeTable& nodes, const std::function<void(NodeId, LiveFolder&)>& describe, std::vector<SnapshotNode>& out, std::string& names)
+		{
+			std::vector<std::pair<NodeId, SnapshotIndex>> sources;
+
+			auto add = [&](SnapshotIndex parent, NodeId live, SnapshotIndex old, std::string_view name) {
+				SnapshotNode node = {};
+				if (old != InvalidSnapshotIndex)
+					node = m_Nodes[old];
+
+				node.parent = parent;
+				node.firstChild = InvalidSnapshotIndex;
+				node.childCount = 0;
+				node.nameOffset = (uint32_t)names.size();
+				node.nameLength = (uint16_t)std::min<size_t>(name.size(), 0xFFFF);
+				names.append(name.data(), node.nameLength);
+
+				if (live != InvalidNode)
+				{
+					if (nodes.Listed(live))
+					{
+						node.entryCount = nodes.EntryCount(live);
+						node.flags |= SnapshotFlags_Listed;
+					}
+
+					LiveFolder folder;
+					describe(live, folder);
+					if (folder.sizeKnown)
+					{
+						node.size = folder.size;
+						node.flags |= SnapshotFlags_SizeKnown;
+					}
+					if (folder.scanned)
+					{
+						node.filesSize = folder.filesSize;
+						node.last_changed = folder.last_changed;
+						node.flags |= SnapshotFlags_Scanned;
+					}
+				}
+
+				out.push_back(node);
+				sources.push_back({ live, old });
+			};
+
+			// Roots first, live ones then the ones only the file knows
+			std::vector<NodeId> liveRoots = nodes.Roots();
+			uint32_t oldRoots = m_Header ? m_Header->rootCount : 0;
+			std::vector<bool> oldRootUsed(oldRoots, false);
+			for (NodeId root : liveRoots)
+			{
+				SnapshotIndex old = InvalidSnapshotIndex;
+				for (SnapshotIndex i = 0; i < oldRoots; i++)
+				{
+					if (NamesEqual(Name(m_Nodes[i]), nodes.Name(root)))
+					{
+						old = i;
+						oldRootUsed[i] = true;
+						break;
+					}
+				}
+				add(InvalidSnapshotIndex, root, old, nodes.Name(root));
+			}
+			for (SnapshotIndex i = 0; i < oldRoots; i++)
+			{
+				if (!oldRootUsed[i])
+					add(InvalidSnapshotIndex, InvalidNode, i, Name(m_Nodes[i]));
+			}
+			uint32_t rootCount = (uint32_t)out.size();
+
+			std::unordered_map<std::string_view, SnapshotIndex> oldChildren;
+			std::unordered_set<std::string_view> liveChildren;
+			for (size_t i = 0; i < out.size(); i++)
+			{
+				auto [live, old] = sources[i];
+				SnapshotIndex first = (SnapshotIndex)out.size();
+
+				oldChildren.clear();
+				if (old != InvalidSnapshotIndex)
+				{
+					const SnapshotNode& folder = m_Nodes[old];
+					for (uint32_t c = 0; c < folder.childCount; c++)
+						oldChildren.emplace(Name(m_Nodes[folder.firstChild + c]), folder.firstChild + c);
+				}
+
+				liveChildren.clear();
+				if (live != InvalidNode)
+				{
+					nodes.ForEachChild(live, [&](NodeId child) {
+						if (nodes.Get(child).kind != EntryKind::Folder)
+							return;
+
+						std::string_view name = nodes.Name(child);
+						auto it = oldChildren.find(name);
+						add((SnapshotIndex)i, child, it != oldChildren.end() ? it->second : InvalidSnapshotIndex, name);
+						liveChildren.insert(name);
+					});
+				}
+
+				bool listed = live != InvalidNode && nodes.Listed(live);
+				if (!listed && old != InvalidSnapshotIndex)
+				{
+					const SnapshotNode& folder = m_Nodes[old];
+					for (uint32_t c = 0; c < folder.childCount; c++)
+					{
+						SnapshotIndex child = folder.firstChild + c;
+						if (!liveChildren.count(Name(m_Nodes[child])))
+							add((SnapshotIndex)i, InvalidNode, child, Name(m_Nodes[child]));
+					}
+				}
+
+				// Sorted, so FindChild can binary search
+				SortChildren(out, sources, names, first);
+
+				out[i].firstChild = first;
+				out[i].childCount = (uint32_t)out.size() - first;
+			}
+			return rootCount;
+		}
+
+		mutable std::shared_mutex m_Mutex;
+		std::mutex m_SaveMutex;
+		std::string m_Path = SNAPSHOT_FILE;
+
+		MappedFile m_File;
+		const SnapshotHeader* m_Header = nullptr;
+		const SnapshotNode* m_Nodes = nullptr;
+		const char* m_Names = nullptr;
+
+		double m_MapMs = 0.0;
+		double m_VerifyMs = 0.0;
+	};
+
+}
\ No newline at end of file
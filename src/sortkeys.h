@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nametable.h"
+
+#define SORT_INSERTION_THRESHOLD 16 // multikey quicksort finishes ranges this small by insertion
+
+namespace File {
+
+	// A row and the number it sorts by, for RadixSort.
+	struct RadixItem {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// A row and its folded sort string, for MultikeyQuicksort.
+	struct StringItem {
+		std::string_view key;
+		uint32_t index;
+	};
+
+	// Flips a signed value so it sorts correctly as unsigned.
+	static inline uint64_t SignedKey(int64_t value) { return (uint64_t)value ^ (1ULL << 63); }
+
+	static std::string FoldString(std::string_view text)
+	{
+		std::string folded(text);
+		for (char& c : folded)
+			c = FoldChar(c);
+		return folded;
+	}
+
+	// Stable LSD radix sort on the 64-bit keys, a byte per pass. All eight
+	// histograms come from one read of the keys, and a pass is skipped when
+	// every key has the same byte there, so sizes and dates that only differ
+	// in a few bytes pay for those bytes only.
+	static void RadixSort(std::vector<RadixItem>& items)
+	{
+		if (items.size() < 2)
+			return;
+
+		std::vector<size_t> counts(8 * 256, 0);
+		for (const RadixItem& item : items)
+		{
+			for (int pass = 0; pass < 8; pass++)
+				counts[pass * 256 + ((item.key >> (pass * 8)) & 0xFF)]++;
+		}
+
+		std::vector<RadixItem> scratch(items.size());
+		for (int pass = 0; pass < 8; pass++)
+		{
+			size_t* count = counts.data() + pass * 256;
+			int shift = pass * 8;
+			if (count[(items[0].key >> shift) & 0xFF] == items.size())
+				continue;
+
+			size_t offset = 0;
+			for (int byte = 0; byte < 256; byte++)
+			{
+				size_t n = count[byte];
+				count[byte] = offset;
+				offset += n;
+			}
+			for (const RadixItem& item : items)
+				scratch[count[(item.key >> shift) & 0xFF]++] = item;
+			items.swap(scratch);
+		}
+	}
+
+	// The character `depth` bytes in, -1 past the end so shorter strings sort
+	// first; negated to sort descending.
+	static inline int SortCharAt(const StringItem& item, size_t depth, bool descending)
+	{
+		int c = depth < item.key.size() ? (unsigned char)item.key[depth] : -1;
+		return descending ? -c : c;
+	}
+
+	static bool StringItemLess(const StringItem& a, const StringItem& b, size_t depth, bool descending)
+	{
+		for (;; depth++)
+		{
+			int ca = SortCharAt(a, depth, descending);
+			int cb = SortCharAt(b, depth, descending);
+			if (ca != cb)
+				return ca < cb;
+			if (ca == (descending ? 1 : -1))
+				return a.index < b.index;
+		}
+	}
+
+	// Bentley-Sedgewick multikey quicksort: a three-way partition on one
+	// character at a time, so a prefix shared by many keys is looked at once
+	// per level instead of once per comparison. Equal keys keep the order of
+	// their indices.
+	static void MultikeyQuicksort(StringItem* items, size_t count, bool descending, size_t depth = 0)
+	{
+		while (count > 1)
+		{
+			if (count < SORT_INSERTION_THRESHOLD)
+			{
+				for (size_t i = 1; i < count; i++)
+				{
+					StringItem item = items[i];
+					size_t j = i;
+					for (; j > 0 && StringItemLess(item, items[j - 1], depth, descending); j--)
+						items[j] = items[j - 1];
+					items[j] = item;
+				}
+				return;
+			}
+
+			int a = SortCharAt(items[0], depth, descending);
+			int b = SortCharAt(items[count / 2], depth, descending);
+			int c = SortCharAt(items[count - 1], depth, descending);
+			int pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+			size_t less = 0, i = 0, greater = count;
+			while (i < greater)
+			{
+				int ch = SortCharAt(items[i], depth, descending);
+				if (ch < pivot)
+					std::swap(items[less++], items[i++]);
+				else if (ch > pivot)
+					std::swap(items[i], items[--greater]);
+				else
+					i++;
+			}
+
+			MultikeyQuicksort(items, less, descending, depth);
+			MultikeyQuicksort(items + greater, count - greater, descending, depth);
+
+			// The middle shares this character; if they all ended here they're equal
+			items += less;
+			count = greater - less;
+			if (pivot == (descending ? 1 : -1))
+			{
+				std::sort(items, items + count, [](const StringItem& x, const StringItem& y) { return x.index < y.index; });
+				return;
+			}
+			depth++;
+		}
+	}
+
+	static void MultikeyQuicksort(std::vector<StringItem>& items, bool descending)
+	{
+		MultikeyQuicksort(items.data(), items.size(), descending);
+	}
+
+	// Numbers each key by the sorted position of its folded form among the
+	// distinct keys, so comparing two ids compares the strings case-
+	// insensitively. Used for extensions, which repeat a lot.
+	static std::vector<uint32_t> RankFolded(const std::vector<std::string_view>& keys)
+	{
+		std::unordered_map<std::string, uint32_t> distinct;
+		std::vector<uint32_t> ids(keys.size());
+		for (size_t i = 0; i < keys.size(); i++)
+			ids[i] = distinct.try_emplace(FoldString(keys[i]), (uint32_t)distinct.size()).first->second;
+
+		std::vector<std::pair<std::string_view, uint32_t>> sorted(distinct.begin(), distinct.end());
+		std::sort(sorted.begin(), sorted.end());
+		std::vector<uint32_t> rank(sorted.size());
+		for (size_t i = 0; i < sorted.size(); i++)
+			rank[sorted[i].second] = (uint32_t)i;
+
+		for (uint32_t& id : ids)
+			id = rank[id];
+		return ids;
+	}
+
+	// Rearranges `rows` into the order of `items`.
+	template<typename Row, typename Item>
+	static void ApplyOrder(std::vector<Row>& rows, const std::vector<Item>& items)
+	{
+		std::vector<Row> sorted;
+		sorted.reserve(rows.size());
+		for (const Item& item : items)
+			sorted.push_back(std::move(rows[item.index]));
+		rows.swap(sorted);
+	}
+
+	// Sorts rows by their `foldedName`; equal names keep their order.
+	template<typename Row>
+	static void SortRowsByName(std::vector<Row>& rows, bool ascending)
+	{
+		std::vector<StringItem> items;
+		items.reserve(rows.size());
+		for (size_t i = 0; i < rows.size(); i++)
+			items.push_back({ rows[i].foldedName, (uint32_t)i });
+		MultikeyQuicksort(items, !ascending);
+		ApplyOrder(rows, items);
+	}
+
+	// Sorts rows by a 64-bit key; equal keys keep their order.
+	template<typename Row, typename Key>
+	static void SortRowsByKey(std::vector<Row>& rows, bool ascending, Key&& key)
+	{
+		std::vector<RadixItem> items;
+		items.reserve(rows.size());
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			uint64_t value = key(rows[i]);
+			items.push_back({ ascending ? value : ~value, (uint32_t)i });
+		}
+		RadixSort(items);
+		ApplyOrder(rows, items);
+	}
+
+}
\ No newline at end of file
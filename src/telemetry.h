@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "executor.h"
+
+#define TELEMETRY_MAX_WORKERS 256 // workers past this share the outside slot
+#define TELEMETRY_FILE "telemetry.json"
+
+namespace File {
+
+	// One thread's counters, alone on a cache line so that workers bumping
+	// their own never invalidate each other's. Only the outside slot has more
+	// than one writer, hence atomics.
+	struct alignas(64) WorkerCounters {
+		std::atomic<uint64_t> directories{ 0 }; // read from disk
+		std::atomic<uint64_t> revalidated{ 0 }; // trusted from the snapshot without reading
+		std::atomic<uint64_t> entries{ 0 };
+		std::atomic<uint64_t> syscalls{ 0 };
+		std::atomic<uint64_t> errors{ 0 }; // directories that couldn't be opened
+	};
+
+	struct TelemetryCounts {
+		uint64_t directories = 0;
+		uint64_t revalidated = 0;
+		uint64_t entries = 0;
+		uint64_t syscalls = 0;
+		uint64_t errors = 0;
+
+		void Add(const TelemetryCounts& other)
+		{
+			directories += other.directories;
+			revalidated += other.revalidated;
+			entries += other.entries;
+			syscalls += other.syscalls;
+			errors += other.errors;
+		}
+	};
+
+	struct WorkerTelemetry {
+		TelemetryCounts counts;
+		uint64_t busyNanoseconds = 0;
+		uint64_t tasks = 0;
+		uint64_t steals = 0;
+		size_t queued = 0;
+	};
+
+	// Everything since the last Reset, summed on demand.
+	struct TelemetrySnapshot {
+		double seconds = 0.0;
+		TelemetryCounts totals;
+		TelemetryCounts outside; // the UI, watcher and other threads off the pool
+		std::vector<WorkerTelemetry> workers;
+		int64_t queued = 0;
+
+		double PerSecond(uint64_t count) const { return seconds > 0.0 ? (double)count / seconds : 0.0; }
+
+		double BusyRatio(const WorkerTelemetry& worker) const
+		{
+			return seconds > 0.0 ? std::min(1.0, (double)worker.busyNanoseconds / (seconds * 1e9)) : 0.0;
+		}
+	};
+
+	class ScanTelemetry {
+	public:
+		// The counters for pool worker `index`; anything else passes
+		// TELEMETRY_MAX_WORKERS for the shared outside slot.
+		WorkerCounters& Slot(size_t index) { return m_Slots[std::min<size_t>(index, TELEMETRY_MAX_WORKERS)]; }
+
+		// Starts a new measurement, e.g. when a scan or search starts. Pool
+		// activity keeps counting, so only its current values are noted.
+		void Reset(const TaskPool& pool)
+		{
+			for (WorkerCounters& slot : m_Slots)
+			{
+				slot.directories = 0;
+				slot.revalidated = 0;
+				slot.entries = 0;
+				slot.syscalls = 0;
+				slot.errors = 0;
+			}
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Baseline.clear();
+			for (unsigned i = 0; i < pool.WorkerCount(); i++)
+				m_Baseline.push_back(pool.Activity(i));
+			m_Start = std::chrono::steady_clock::now();
+		}
+
+		TelemetrySnapshot Aggregate(const TaskPool& pool)
+		{
+			TelemetrySnapshot snapshot;
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			snapshot.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+			snapshot.queued = pool.QueuedTasks();
+
+			for (unsigned i = 0; i < pool.WorkerCount(); i++)
+			{
+				WorkerTelemetry& worker = snapshot.workers.emplace_back();
+				if (i < TELEMETRY_MAX_WORKERS)
+					worker.counts = Read(m_Slots[i]);
+
+				TaskPool::WorkerActivity activity = pool.Activity(i);
+				TaskPool::WorkerActivity baseline = i < m_Baseline.size() ? m_Baseline[i] : TaskPool::WorkerActivity();
+				// A restarted pool starts from zero again
+				if (activity.tasks < baseline.tasks)
+					baseline = TaskPool::WorkerActivity();
+				worker.busyNanoseconds = activity.busyNanoseconds - baseline.busyNanoseconds;
+				worker.tasks = activity.tasks - baseline.tasks;
+				worker.steals = activity.steals - baseline.steals;
+				worker.queued = activity.queued;
+
+				snapshot.totals.Add(worker.counts);
+			}
+
+			snapshot.outside = Read(m_Slots[TELEMETRY_MAX_WORKERS]);
+			snapshot.totals.Add(snapshot.outside);
+			return snapshot;
+		}
+
+	private:
+		static TelemetryCounts Read(const WorkerCounters& slot)
+		{
+			TelemetryCounts counts;
+			counts.directories = slot.directories.load(std::memory_order_relaxed);
+			counts.revalidated = slot.revalidated.load(std::memory_order_relaxed);
+			counts.entries = slot.entries.load(std::memory_order_relaxed);
+			counts.syscalls = slot.syscalls.load(std::memory_order_relaxed);
+			counts.errors = slot.errors.load(std::memory_order_relaxed);
+			return counts;
+		}
+
+		std::array<WorkerCounters, TELEMETRY_MAX_WORKERS + 1> m_Slots;
+
+		std::mutex m_Mutex;
+		std::vector<TaskPool::WorkerActivity> m_Baseline;
+		std::chrono::steady_clock::time_point m_Start = std::chrono::steady_clock::now();
+	};
+
+	static void WriteCountsJson(std::ostream& out, const TelemetryCounts& counts)
+	{
+		out << "\"directories\":" << counts.directories << ",\"revalidated\":" << counts.revalidated << ",\"entries\":" << counts.entries
+			<< ",\"syscalls\":" << counts.syscalls << ",\"errors\":" << counts.errors;
+	}
+
+	static std::string TelemetryJson(const TelemetrySnapshot& snapshot)
+	{
+		std::ostringstream out;
+		out << "{\"seconds\":" << snapshot.seconds << ",";
+		WriteCountsJson(out, snapshot.totals);
+		out << ",\"directories_per_sec\":" << snapshot.PerSecond(snapshot.totals.directories + snapshot.totals.revalidated)
+			<< ",\"entries_per_sec\":" << snapshot.PerSecond(snapshot.totals.entries)
+			<< ",\"syscalls_per_sec\":" << snapshot.PerSecond(snapshot.totals.syscalls)
+			<< ",\"queued\":" << snapshot.queued << ",\"outside\":{";
+		WriteCountsJson(out, snapshot.outside);
+		out << "},\"workers\":[";
+
+		for (size_t i = 0; i < snapshot.workers.size(); i++)
+		{
+			const WorkerTelemetry& worker = snapshot.workers[i];
+			double busy = snapshot.BusyRatio(worker);
+			out << (i ? "," : "") << "{\"worker\":" << i << ",";
+			WriteCountsJson(out, worker.counts);
+			out << ",\"tasks\":" << worker.tasks << ",\"steals\":" << worker.steals << ",\"queued\":" << worker.queued
+				<< ",\"busy_ratio\":" << busy << ",\"idle_ratio\":" << 1.0 - busy << "}";
+		}
+		out << "]}";
+		return out.str();
+	}
+
+	static bool SaveTelemetryJson(const char* path, const TelemetrySnapshot& snapshot)
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file)
+			return false;
+
+		std::string json = TelemetryJson(snapshot);
+		bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+		return std::fclose(file) == 0 && written;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define ENABLE_TRACING true // false compiles every TRACE_SCOPE out
+#define TRACE_RING_SIZE 65536 // spans kept per thread, a power of two; older ones are overwritten
+#define TRACE_FILE "trace.json"
+
+namespace File {
+
+	// One recorded span. The fields are atomics only so the exporter may read
+	// a slot the owning thread is overwriting; relaxed stores are plain moves.
+	struct TraceSlot {
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<uint64_t> start{ 0 }; // ns since the tracer was created
+		std::atomic<uint64_t> duration{ 0 };
+	};
+
+	// A thread's spans. Only that thread writes; `head` counts every span it
+	// ever recorded, so a reader can tell which slots were overwritten.
+	struct TraceRing {
+		std::unique_ptr<TraceSlot[]> slots = std::make_unique<TraceSlot[]>(TRACE_RING_SIZE);
+		std::atomic<uint64_t> head{ 0 };
+		uint64_t clearedAt = 0; // head when Clear() ran; guarded by the tracer's mutex
+		uint32_t threadId = 0;
+		std::string threadName;
+	};
+
+	// Scoped spans recorded into per thread rings and exported as Chrome
+	// trace-event JSON (chrome://tracing, ui.perfetto.dev). Off by default;
+	// while off a span costs one relaxed load.
+	class Tracer {
+	public:
+		bool Enabled() const { return m_Enabled.load(std::memory_order_relaxed); }
+		void SetEnabled(bool enabled) { m_Enabled.store(enabled, std::memory_order_relaxed); }
+
+		uint64_t Now() const
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Epoch).count();
+		}
+
+		void Record(const char* name, uint64_t start, uint64_t end)
+		{
+			TraceRing& ring = Local();
+			uint64_t index = ring.head.load(std::memory_order_relaxed);
+			TraceSlot& slot = ring.slots[index & (TRACE_RING_SIZE - 1)];
+			slot.name.store(name, std::memory_order_relaxed);
+			slot.start.store(start, std::memory_order_relaxed);
+			slot.duration.store(end - start, std::memory_order_relaxed);
+			ring.head.store(index + 1, std::memory_order_release);
+		}
+
+		// Labels the calling thread's track in the exported trace.
+		void NameThread(const std::string& name)
+		{
+			t_Name = name;
+			if (t_Ring)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				t_Ring->threadName = name;
+			}
+		}
+
+		// Drops everything recorded so far.
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (auto& ring : m_Rings)
+				ring->clearedAt = ring->head.load(std::memory_order_acquire);
+		}
+
+		// Writes the spans still in the rings; safe while threads keep recording.
+		bool Export(const char* path)
+		{
+			std::FILE* file = std::fopen(path, "wb");
+			if (!file)
+				return false;
+
+			std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+			bool first = true;
+			size_t spans = 0;
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (auto& ring : m_Rings)
+			{
+				std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+					first ? "" : ",\n", ring->threadId, ring->threadName.c_str());
+				first = false;
+
+				struct Span {
+					uint64_t index;
+					const char* name;
+					uint64_t start;
+					uint64_t duration;
+				};
+
+				uint64_t head = ring->head.load(std::memory_order_acquire);
+				uint64_t begin = std::max(ring->clearedAt, head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0);
+				std::vector<Span> copied;
+				copied.reserve((size_t)(head - begin));
+				for (uint64_t i = begin; i < head; i++)
+				{
+					const TraceSlot& slot = ring->slots[i & (TRACE_RING_SIZE - 1)];
+					copied.push_back({ i, slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+						slot.duration.load(std::memory_order_relaxed) });
+				}
+
+				// Slots the thread wrote again while they were copied are torn
+				std::atomic_thread_fence(std::memory_order_acquire);
+				uint64_t after = ring->head.load(std::memory_order_relaxed);
+				uint64_t valid = after > TRACE_RING_SIZE ? after - TRACE_RING_SIZE : 0;
+
+				for (const Span& span : copied)
+				{
+					if (span.index < valid || !span.name)
+						continue;
+
+					std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", span.name, ring->threadId,
+						span.start / 1000.0, span.duration / 1000.0);
+					spans++;
+				}
+			}
+
+			std::fputs("\n]}\n", file);
+			m_LastExportSpans = spans;
+			return std::fclose(file) == 0;
+		}
+
+		size_t LastExportSpans() const { return m_LastExportSpans; }
+
+	private:
+		// Rings are never freed, so spans of threads that have exited still export.
+		TraceRing& Local()
+		{
+			if (!t_Ring)
+			{
+				auto ring = std::make_unique<TraceRing>();
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				ring->threadId = (uint32_t)m_Rings.size() + 1;
+				ring->threadName = t_Name.empty() ? "thread " + std::to_string(ring->threadId) : t_Name;
+				t_Ring = ring.get();
+				m_Rings.push_back(std::move(ring));
+			}
+			return *t_Ring;
+		}
+
+		std::atomic<bool> m_Enabled{ false };
+		std::chrono::steady_clock::time_point m_Epoch = std::chrono::steady_clock::now();
+
+		std::mutex m_Mutex;
+		std::vector<std::unique_ptr<TraceRing>> m_Rings;
+		size_t m_LastExportSpans = 0;
+
+		static inline thread_local TraceRing* t_Ring = nullptr;
+		static inline thread_local std::string t_Name;
+	};
+
+	Tracer Tracing;
+
+	// Records the enclosing scope as a span named `name`, which must be a
+	// string literal (only the pointer is kept).
+	class TraceSpan {
+	public:
+		explicit TraceSpan(const char* name)
+		{
+			if (Tracing.Enabled())
+			{
+				m_Name = name;
+				m_Start = Tracing.Now();
+			}
+		}
+
+		~TraceSpan() { End(); }
+
+		// Ends the span before the scope does.
+		void End()
+		{
+			if (m_Name)
+				Tracing.Record(m_Name, m_Start, Tracing.Now());
+			m_Name = nullptr;
+		}
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+	private:
+		const char* m_Name = nullptr;
+		uint64_t m_Start = 0;
+	};
+
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if ENABLE_TRACING
+#define TRACE_SCOPE(name) File::TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#define TREE_NAME_ALPHABET "abcdefghijklmnopqrstuvwxyz0123456789_-"
+
+namespace File {
+
+	// Shape of a synthetic tree for benchmarks. The same spec and seed always
+	// give the same names, sizes and layout.
+	struct TreeSpec {
+		uint32_t depth = 4; // folder levels below the root
+		uint32_t fanOut = 6; // sub folders per folder
+		uint32_t filesPerFolder = 24;
+		uint32_t minNameLength = 4;
+		uint32_t maxNameLength = 24;
+		uint32_t longNamePercent = 2; // names drawn from (maxNameLength, longNameLength] instead
+		uint32_t longNameLength = 160;
+		uint32_t wideFolders = 1; // extra folders under the root holding wideFolderFiles each
+		uint32_t wideFolderFiles = 20000;
+		uint64_t maxFileSize = 1 << 20; // sizes are sparse, so large ones cost nothing to write
+		uint64_t seed = 1;
+	};
+
+	struct TreeStats {
+		uint64_t files = 0;
+		uint64_t folders = 0;
+		uint64_t bytes = 0;
+		uint64_t nameBytes = 0;
+	};
+
+	class TreeGenerator {
+	public:
+		TreeGenerator(const TreeSpec& spec) : m_Spec(spec), m_State(spec.seed) {}
+
+		// Creates the tree under `root`, which must not exist yet.
+		bool Generate(const std::filesystem::path& root, TreeStats& stats)
+		{
+			std::error_code error;
+			if (std::filesystem::exists(root, error))
+			{
+				std::cerr << root.string() << " already exists\n";
+				return false;
+			}
+			if (!std::filesystem::create_directories(root, error))
+			{
+				std::cerr << "Can't create " << root.string() << ": " << error.message() << "\n";
+				return false;
+			}
+
+			stats = {};
+			if (!GenerateFolder(root, m_Spec.depth, stats))
+				return false;
+
+			for (uint32_t i = 0; i < m_Spec.wideFolders; i++)
+			{
+				std::filesystem::path wide = root / ("wide_" + std::to_string(i));
+				if (!std::filesystem::create_directory(wide, error))
+					return Fail(wide, error);
+				stats.folders++;
+				for (uint32_t file = 0; file < m_Spec.wideFolderFiles; file++)
+				{
+					if (!MakeFile(wide, stats))
+						return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		// splitmix64
+		uint64_t Next()
+		{
+			uint64_t z = (m_State += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+
+		uint32_t Between(uint32_t low, uint32_t high) { return high <= low ? low : low + (uint32_t)(Next() % (high - low + 1)); }
+
+		// A random name, with a counter appended so siblings never collide
+		std::string MakeName(uint64_t unique, const char* extension)
+		{
+			uint32_t length = Next() % 100 < m_Spec.longNamePercent
+				? Between(m_Spec.maxNameLength + 1, m_Spec.longNameLength)
+				: Between(m_Spec.minNameLength, m_Spec.maxNameLength);
+
+			static const char alphabet[] = TREE_NAME_ALPHABET;
+			std::string name(length, 'a');
+			for (char& c : name)
+				c = alphabet[Next() % (sizeof(alphabet) - 1)];
+			name += "_" + std::to_string(unique);
+			name += extension;
+			return name;
+		}
+
+		bool MakeFile(const std::filesystem::path& folder, TreeStats& stats)
+		{
+			static const char* extensions[] = { ".txt", ".log", ".cpp", ".h", ".png", ".json", ".bin", "" };
+			std::string name = MakeName(stats.files, extensions[Next() % (sizeof(extensions) / sizeof(extensions[0]))]);
+			std::filesystem::path path = folder / name;
+
+			std::FILE* file = std::fopen(path.string().c_str(), "wb");
+			if (!file)
+			{
+				std::cerr << "Can't create " << path.string() << "\n";
+				return false;
+			}
+			std::fclose(file);
+
+			uint64_t size = m_Spec.maxFileSize ? Next() % (m_Spec.maxFileSize + 1) : 0;
+			std::error_code error;
+			if (size)
+			{
+				std::filesystem::resize_file(path, size, error);
+				if (error)
+					return Fail(path, error);
+			}
+
+			stats.files++;
+			stats.bytes += size;
+			stats.nameBytes += name.size();
+			return true;
+		}
+
+		bool GenerateFolder(const std::filesystem::path& folder, uint32_t levels, TreeStats& stats)
+		{
+			for (uint32_t i = 0; i < m_Spec.filesPerFolder; i++)
+			{
+				if (!MakeFile(folder, stats))
+					return false;
+			}
+			if (levels == 0)
+				return true;
+
+			for (uint32_t i = 0; i < m_Spec.fanOut; i++)
+			{
+				std::string name = MakeName(stats.folders, "");
+				std::filesystem::path child = folder / name;
+				std::error_code error;
+				if (!std::filesystem::create_directory(child, error))
+					return Fail(child, error);
+
+				stats.folders++;
+				stats.nameBytes += name.size();
+				if (!GenerateFolder(child, levels - 1, stats))
+					return false;
+			}
+			return true;
+		}
+
+		static bool Fail(const std::filesystem::path& path, const std::error_code& error)
+		{
+			std::cerr << "Can't create " << path.string() << ": " << error.message() << "\n";
+			return false;
+		}
+
+		TreeSpec m_Spec;
+		uint64_t m_State;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,719 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nametable.h"
+#include "nodes.h"
+#include "snapshot.h"
+
+#define NAME_INDEX_FILE "name_index.bin"
+#define NAME_INDEX_MAGIC "EXPNAMES"
+#define NAME_INDEX_VERSION 2 // 2: names end in '\0', folded copy of the pool
+#define NAME_SCAN_PARTS 256 // most pieces a full sweep is split into
+#define NAME_SCAN_MIN_PART 16384 // fewest names per piece
+
+namespace File {
+
+	// On-disk layout: header, `entryCount` NameIndexEntries (breadth first, like
+	// the size snapshot), the name pool padded to 8 bytes, the same pool
+	// lower-cased (the FoldedNameTable, read in place), `trigramCount`
+	// TrigramPostings sorted by trigram, then the posting lists. Every name is
+	// followed by a '\0', and name offsets are 32-bit, so the pool stays under
+	// 4 GB. A posting list is the ascending entry indices of every name
+	// containing the trigram, stored as varint-encoded gaps.
+	struct NameIndexHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint64_t created; // FILETIME ticks
+		uint32_t entryCount;
+		uint32_t rootCount;
+		uint64_t namesSize;
+		uint32_t trigramCount;
+		uint32_t reserved;
+		uint64_t postingsSize;
+		uint64_t checksum; // of everything after the header
+	};
+	static_assert(sizeof(NameIndexHeader) == 64, "NameIndexHeader is part of the file format");
+
+	enum NameIndexFlags : uint8_t {
+		NameIndexFlags_None = 0,
+		NameIndexFlags_Listed = 1 << 0, // children are complete
+	};
+
+	struct NameIndexEntry {
+		uint64_t size;
+		uint64_t last_changed;
+		uint32_t parent;
+		uint32_t firstChild;
+		uint32_t childCount;
+		uint32_t nameOffset;
+		uint16_t nameLength;
+		EntryKind kind;
+		uint8_t flags;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(NameIndexEntry) == 40, "NameIndexEntry is part of the file format");
+
+	struct TrigramPosting {
+		uint32_t trigram;
+		uint32_t count;
+		uint64_t offset; // into the posting lists
+	};
+	static_assert(sizeof(TrigramPosting) == 16, "TrigramPosting is part of the file format");
+
+	struct NameIndexMatch {
+		std::string directory; // path of the parent, empty for a root
+		std::string name;
+		EntryKind kind;
+		uint64_t size;
+		uint64_t last_changed;
+		uint32_t depth;
+	};
+
+	// Runs fn(i) for every i below count and returns once all of them are done.
+	using ParallelFor = std::function<void(size_t, const std::function<void(size_t)>&)>;
+
+	struct NameIndexEntry;
+
+	// Extra check on a name that already matched; see NameIndex::EntryDirectory.
+	using NameIndexFilter = std::function<bool(const NameIndexEntry&, std::string_view name, uint32_t index)>;
+
+	// Names are matched case-insensitively for ASCII only, like NameMatcher
+	static inline uint32_t PackTrigram(const char* bytes)
+	{
+		return ((uint32_t)(unsigned char)FoldChar(bytes[0]) << 16) | ((uint32_t)(unsigned char)FoldChar(bytes[1]) << 8) | (unsigned char)FoldChar(bytes[2]);
+	}
+
+	// Unique trigrams of `text`, sorted.
+	static void ExtractTrigrams(std::string_view text, std::vector<uint32_t>& trigrams)
+	{
+		trigrams.clear();
+		for (size_t i = 0; i + 3 <= text.size(); i++)
+			trigrams.push_back(PackTrigram(text.data() + i));
+		std::sort(trigrams.begin(), trigrams.end());
+		trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+	}
+
+	static inline void PutVarint(std::vector<uint8_t>& out, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	static inline const uint8_t* GetVarint(const uint8_t* in, uint32_t& value)
+	{
+		value = 0;
+		for (int shift = 0;; shift += 7)
+		{
+			uint8_t byte = *in++;
+			value |= (uint32_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return in;
+		}
+	}
+
+	// Case-insensitive substring search over every name seen by a scan,
+	// without touching the disk. A query's trigrams select candidates by
+	// intersecting their posting lists, and each candidate is then checked
+	// against its folded name. Queries shorter than a trigram sweep the whole
+	// FoldedNameTable instead, split across workers.
+	class NameIndex {
+	public:
+		bool Load(const std::string& path)
+		{
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+			m_Path = path;
+			return Map();
+		}
+
+		bool Loaded() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_Header != nullptr;
+		}
+
+		uint32_t EntryCount() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_Header ? m_Header->entryCount : 0;
+		}
+
+		uint32_t TrigramCount() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_Header ? m_Header->trigramCount : 0;
+		}
+
+		size_t FileSize() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_File.Size();
+		}
+
+		double LoadMilliseconds() const { return m_LoadMs; }
+		double BuildMilliseconds() const { return m_BuildMs; }
+		double LastQueryMilliseconds() const { return m_QueryMs; }
+		uint32_t LastCandidateCount() const { return m_Candidates; }
+
+		// Entries picked by a filter (e.g. the best ranked), as matches.
+		std::vector<NameIndexMatch> Matches(const std::vector<uint32_t>& indices) const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			if (!m_Header)
+				return {};
+			return MatchesOf(indices);
+		}
+
+		// Folder path and depth of entry `index`. Only for a NameIndexFilter,
+		// which runs while Query holds the lock.
+		void EntryDirectory(uint32_t index, std::string& out) const
+		{
+			BuildPath(m_Entries[index].parent, out);
+		}
+
+		uint32_t EntryDepth(uint32_t index) const
+		{
+			uint32_t depth = 0;
+			for (uint32_t i = m_Entries[index].parent; i != InvalidSnapshotIndex; i = m_Entries[i].parent)
+				depth++;
+			return depth;
+		}
+
+		// Whether entry `index` lies at most `levels` folders below one of
+		// `folders`. Only for a NameIndexFilter, like EntryDirectory.
+		bool EntryWithin(uint32_t index, const std::vector<uint32_t>& folders, int levels) const
+		{
+			uint32_t i = m_Entries[index].parent;
+			for (int level = 1; level <= levels && i != InvalidSnapshotIndex; level++, i = m_Entries[i].parent)
+			{
+				if (std::find(folders.begin(), folders.end(), i) != folders.end())
+					return true;
+			}
+			return false;
+		}
+
+		// Entry of the folder at `path`, or InvalidSnapshotIndex unless the
+		// scan the index was built from listed it.
+		uint32_t FindListedFolder(std::string_view path) const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			if (!m_Header)
+				return InvalidSnapshotIndex;
+
+			std::string_view rest;
+			std::string_view rootName = NodeTable::SplitRoot(path, rest);
+			uint32_t folder = InvalidSnapshotIndex;
+			for (uint32_t i = 0; i < m_Header->rootCount && folder == InvalidSnapshotIndex; i++)
+			{
+				if (NamesEqual(Name(i), rootName))
+					folder = i;
+			}
+
+			while (folder != InvalidSnapshotIndex && !rest.empty())
+			{
+				std::string_view name = NodeTable::NextComponent(rest);
+				const NameIndexEntry& entry = m_Entries[folder];
+				folder = InvalidSnapshotIndex;
+				for (uint32_t c = 0; c < entry.childCount; c++)
+				{
+					if (NamesEqual(Name(entry.firstChild + c), name))
+					{
+						folder = entry.firstChild + c;
+						break;
+					}
+				}
+			}
+
+			if (folder == InvalidSnapshotIndex || m_Entries[folder].kind != EntryKind::Folder || !(m_Entries[folder].flags & NameIndexFlags_Listed))
+				return InvalidSnapshotIndex;
+			return folder;
+		}
+
+		size_t FoldedBytes() const
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			return m_Folded.Bytes();
+		}
+
+		// Names containing `query` that also pass `filter`. An empty query
+		// sweeps every entry through the filter.
+		std::vector<NameIndexMatch> Query(std::string_view query, size_t limit, const ParallelFor& parallelFor = nullptr, const NameIndexFilter& filter = nullptr)
+		{
+			std::vector<NameIndexMatch> matches;
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			if (!m_Header || (query.empty() && !filter))
+				return matches;
+
+			auto start = std::chrono::steady_clock::now();
+
+			std::string folded(query);
+			for (char& c : folded)
+				c = FoldChar(c);
+
+			std::vector<uint32_t> found;
+			if (folded.size() < 3)
+			{
+				m_Candidates = m_Header->entryCount;
+				ScanAll(folded, limit, parallelFor, filter, found);
+			}
+			else
+			{
+				std::vector<uint32_t> candidates;
+				Candidates(folded, candidates);
+				m_Candidates = (uint32_t)candidates.size();
+				for (size_t i = 0; i < candidates.size() && found.size() < limit; i++)
+				{
+					if (m_Folded.Contains(candidates[i], folded) && Accepts(filter, candidates[i]))
+						found.push_back(candidates[i]);
+				}
+			}
+
+			matches = MatchesOf(found);
+			m_QueryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return matches;
+		}
+
+		// Indexes every entry of `nodes` merged with the entries of the current
+		// file under folders this session hasn't listed, then swaps the file.
+		bool Build(const NodeTable& nodes, const std::function<bool(NodeId, uint64_t&)>& folderSize)
+		{
+			std::lock_guard<std::mutex> buildLock(m_BuildMutex);
+			auto start = std::chrono::steady_clock::now();
+
+			std::vector<NameIndexEntry> entries;
+			std::string names;
+			uint32_t rootCount = 0;
+			{
+				std::shared_lock<std::shared_mutex> lock(m_Mutex);
+				rootCount = Merge(nodes, folderSize, entries, names);
+			}
+			if (names.size() > UINT32_MAX)
+			{
+				std::cerr << "Name index not written: " << names.size() << " bytes of names is more than its 32-bit offsets can address\n";
+				return false;
+			}
+			names.resize((names.size() + 7) & ~(size_t)7, '\0');
+			std::string folded(names);
+			for (char& c : folded)
+				c = FoldChar(c);
+
+			// Entries are visited in index order, so every gap is positive
+			struct Builder {
+				std::vector<uint8_t> bytes;
+				uint32_t last = 0;
+				uint32_t count = 0;
+			};
+			std::unordered_map<uint32_t, Builder> builders;
+			std::vector<uint32_t> trigrams;
+			for (uint32_t i = 0; i < (uint32_t)entries.size(); i++)
+			{
+				ExtractTrigrams(std::string_view(names.data() + entries[i].nameOffset, entries[i].nameLength), trigrams);
+				for (uint32_t trigram : trigrams)
+				{
+					Builder& builder = builders[trigram];
+					PutVarint(builder.bytes, builder.count == 0 ? i : i - builder.last);
+					builder.last = i;
+					builder.count++;
+				}
+			}
+
+			std::vector<TrigramPosting> table;
+			table.reserve(builders.size());
+			for (const auto& [trigram, builder] : builders)
+				table.push_back({ trigram, builder.count, 0 });
+			std::sort(table.begin(), table.end(), [](const TrigramPosting& a, const TrigramPosting& b) { return a.trigram < b.trigram; });
+
+			std::string postings;
+			for (TrigramPosting& posting : table)
+			{
+				const Builder& builder = builders[posting.trigram];
+				posting.offset = postings.size();
+				postings.append((const char*)builder.bytes.data(), builder.bytes.size());
+			}
+			builders.clear();
+
+			NameIndexHeader header = {};
+			memcpy(header.magic, NAME_INDEX_MAGIC, sizeof(header.magic));
+			header.version = NAME_INDEX_VERSION;
+			header.headerSize = sizeof(NameIndexHeader);
+			header.created = (uint64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() * 10000000ULL + FILETIME_UNIX_EPOCH;
+			header.entryCount = (uint32_t)entries.size();
+			header.rootCount = rootCount;
+			header.namesSize = names.size();
+			header.trigramCount = (uint32_t)table.size();
+			header.postingsSize = postings.size();
+
+			std::string_view parts[] = {
+				std::string_view((const char*)entries.data(), entries.size() * sizeof(NameIndexEntry)),
+				names,
+				folded,
+				std::string_view((const char*)table.data(), table.size() * sizeof(TrigramPosting)),
+				postings,
+			};
+			header.checksum = 0xcbf29ce484222325ULL;
+			for (std::string_view part : parts)
+				header.checksum = Checksum64((const uint8_t*)part.data(), part.size(), header.checksum);
+
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+			Unmap();
+			bool ok = WriteFileAtomic(m_Path, { std::string_view((const char*)&header, sizeof(header)), parts[0], parts[1], parts[2], parts[3], parts[4] });
+			if (!ok)
+				std::cerr << "Failed to write " << m_Path << "\n";
+			Map();
+
+			m_BuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return ok;
+		}
+
+	private:
+		// Everything below expects m_Mutex to be held.
+		std::vector<NameIndexMatch> MatchesOf(const std::vector<uint32_t>& indices) const
+		{
+			std::vector<NameIndexMatch> matches(indices.size());
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				const NameIndexEntry& entry = m_Entries[indices[i]];
+				NameIndexMatch& match = matches[i];
+				match.name.assign(m_Names + entry.nameOffset, entry.nameLength);
+				match.kind = entry.kind;
+				match.size = entry.size;
+				match.last_changed = entry.last_changed;
+				match.depth = BuildPath(entry.parent, match.directory);
+			}
+			return matches;
+		}
+
+		bool Accepts(const NameIndexFilter& filter, uint32_t index) const
+		{
+			return !filter || filter(m_Entries[index], Name(index), index);
+		}
+
+		void ScanAll(const std::string& folded, size_t limit, const ParallelFor& parallelFor, const NameIndexFilter& filter, std::vector<uint32_t>& found) const
+		{
+			uint32_t count = m_Folded.Count();
+			size_t parts = parallelFor ? std::min<size_t>(NAME_SCAN_PARTS, std::max<uint32_t>(1, count / NAME_SCAN_MIN_PART)) : 1;
+			std::vector<std::vector<uint32_t>> partFound(parts);
+
+			auto scanPart = [&](size_t part) {
+				uint32_t first = (uint32_t)((uint64_t)count * part / parts);
+				uint32_t last = (uint32_t)((uint64_t)count * (part + 1) / parts);
+				std::vector<uint32_t>& out = partFound[part];
+				if (folded.empty())
+				{
+					for (uint32_t index = first; index < last && out.size() < limit; index++)
+					{
+						if (Accepts(filter, index))
+							out.push_back(index);
+					}
+					return;
+				}
+
+				m_Folded.Scan(folded, first, last, [&](uint32_t index) {
+					if (Accepts(filter, index))
+						out.push_back(index);
+					return out.size() < limit;
+				});
+			};
+
+			if (parts > 1)
+				parallelFor(parts, scanPart);
+			else
+				scanPart(0);
+
+			for (const auto& part : partFound)
+			{
+				for (size_t i = 0; i < part.size() && found.size() < limit; i++)
+					found.push_back(part[i]);
+			}
+		}
+
+		const TrigramPosting* FindTrigram(uint32_t trigram) const
+		{
+			const TrigramPosting* end = m_Trigrams + m_Header->trigramCount;
+			const TrigramPosting* it = std::lower_bound(m_Trigrams, end, trigram, [](const TrigramPosting& posting, uint32_t value) { return posting.trigram < value; });
+			return it != end && it->trigram == trigram ? it : nullptr;
+		}
+
+		// Intersects the posting lists of every trigram in `folded`, shortest first.
+		void Candidates(const std::string& folded, std::vector<uint32_t>& candidates) const
+		{
+			std::vector<uint32_t> trigrams;
+			ExtractTrigrams(folded, trigrams);
+
+			std::vector<const TrigramPosting*> lists;
+			for (uint32_t trigram : trigrams)
+			{
+				const TrigramPosting* posting = FindTrigram(trigram);
+				if (!posting)
+					return;
+				lists.push_back(posting);
+			}
+			std::sort(lists.begin(), lists.end(), [](const TrigramPosting* a, const TrigramPosting* b) { return a->count < b->count; });
+
+			const uint8_t* in = m_Postings + lists[0]->offset;
+			candidates.resize(lists[0]->count);
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < lists[0]->count; i++)
+			{
+				uint32_t gap;
+				in = GetVarint(in, gap);
+				value = i == 0 ? gap : value + gap;
+				candidates[i] = value;
+			}
+
+			for (size_t l = 1; l < lists.size() && !candidates.empty(); l++)
+			{
+				in = m_Postings + lists[l]->offset;
+				size_t kept = 0;
+				size_t next = 0;
+				value = 0;
+				for (uint32_t i = 0; i < lists[l]->count && next < candidates.size(); i++)
+				{
+					uint32_t gap;
+					in = GetVarint(in, gap);
+					value = i == 0 ? gap : value + gap;
+
+					while (next < candidates.size() && candidates[next] < value)
+						next++;
+					if (next < candidates.size() && candidates[next] == value)
+						candidates[kept++] = candidates[next++];
+				}
+				candidates.resize(kept);
+			}
+		}
+
+		// Path of entry `index` into `out`; returns its depth (roots are 0).
+		// Measured first and filled from the end, like NodeTable::BuildPath.
+		uint32_t BuildPath(uint32_t index, std::string& out) const
+		{
+			auto separated = [this](uint32_t parent) {
+				if (parent == InvalidSnapshotIndex)
+					return false;
+				const NameIndexEntry& entry = m_Entries[parent];
+				return entry.nameLength > 0 && m_Names[entry.nameOffset + entry.nameLength - 1] != PATH_SEPARATOR;
+			};
+
+			size_t length = 0;
+			uint32_t depth = 0;
+			for (uint32_t i = index; i != InvalidSnapshotIndex; i = m_Entries[i].parent)
+			{
+				length += m_Entries[i].nameLength + (separated(m_Entries[i].parent) ? 1 : 0);
+				depth++;
+			}
+
+			out.resize(length);
+			for (uint32_t i = index; i != InvalidSnapshotIndex; i = m_Entries[i].parent)
+			{
+				const NameIndexEntry& entry = m_Entries[i];
+				length -= entry.nameLength;
+				memcpy(out.data() + length, m_Names + entry.nameOffset, entry.nameLength);
+				if (separated(entry.parent))
+					out[--length] = PATH_SEPARATOR;
+			}
+			return depth;
+		}
+
+		bool Map()
+		{
+			Unmap();
+
+			auto start = std::chrono::steady_clock::now();
+			if (!m_File.Open(m_Path))
+				return false;
+
+			const uint8_t* data = m_File.Data();
+			size_t size = m_File.Size();
+			const NameIndexHeader* header = (const NameIndexHeader*)data;
+			if (size < sizeof(NameIndexHeader) || memcmp(header->magic, NAME_INDEX_MAGIC, sizeof(header->magic)) != 0
+				|| header->headerSize != sizeof(NameIndexHeader) || header->version != NAME_INDEX_VERSION)
+			{
+				std::cerr << m_Path << " is not a name index this version can read\n";
+				m_File.Close();
+				return false;
+			}
+
+			uint64_t payload = (uint64_t)header->entryCount * sizeof(NameIndexEntry) + 2 * header->namesSize
+				+ (uint64_t)header->trigramCount * sizeof(TrigramPosting) + header->postingsSize;
+			if (header->rootCount > header->entryCount || (header->namesSize & 7) != 0 || header->namesSize > (uint64_t)UINT32_MAX + 8
+				|| size - sizeof(NameIndexHeader) != payload)
+			{
+				std::cerr << m_Path << " is truncated\n";
+				m_File.Close();
+				return false;
+			}
+			if (Checksum64(data + sizeof(NameIndexHeader), (size_t)payload) != header->checksum)
+			{
+				std::cerr << m_Path << " failed its checksum\n";
+				m_File.Close();
+				return false;
+			}
+
+			m_Header = header;
+			m_Entries = (const NameIndexEntry*)(data + sizeof(NameIndexHeader));
+			m_Names = (const char*)(m_Entries + header->entryCount);
+			const char* folded = m_Names + header->namesSize;
+			m_Trigrams = (const TrigramPosting*)(folded + header->namesSize);
+			m_Postings = (const uint8_t*)(m_Trigrams + header->trigramCount);
+
+			m_Folded.Attach(folded, (size_t)header->namesSize, &m_Entries[0].nameOffset, sizeof(NameIndexEntry), header->entryCount);
+			m_LoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return true;
+		}
+
+		void Unmap()
+		{
+			m_File.Close();
+			m_Header = nullptr;
+			m_Entries = nullptr;
+			m_Names = nullptr;
+			m_Trigrams = nullptr;
+			m_Postings = nullptr;
+			m_Folded.Clear();
+		}
+
+		std::string_view Name(uint32_t index) const { return std::string_view(m_Names + m_Entries[index].nameOffset, m_Entries[index].nameLength); }
+
+		// Same walk as SizeSnapshot::Merge, over files as well as folders.
+		uint32_t Merge(const NodeTable& nodes, const std::function<bool(NodeId, uint64_t&)>& folderSize, std::vector<NameIndexEntry>& out, std::string& names)
+		{
+			std::vector<std::pair<NodeId, uint32_t>> sources;
+
+			auto add = [&](uint32_t parent, NodeId live, uint32_t old, std::string_view name) {
+				NameIndexEntry entry = {};
+				if (old != InvalidSnapshotIndex)
+					entry = m_Entries[old];
+
+				entry.parent = parent;
+				entry.firstChild = InvalidSnapshotIndex;
+				entry.childCount = 0;
+				entry.nameOffset = (uint32_t)names.size();
+				entry.nameLength = (uint16_t)std::min<size_t>(name.size(), 0xFFFF);
+				names.append(name.data(), entry.nameLength);
+				names.push_back('\0'); // keeps matches in the folded copy within one name
+
+				if (live != InvalidNode)
+				{
+					const Node& node = nodes.Get(live);
+					entry.kind = node.kind;
+					uint64_t lastChanged = nodes.LastChanged(live);
+					entry.last_changed = lastChanged ? lastChanged : entry.last_changed;
+					entry.flags = nodes.Listed(live) ? (uint8_t)NameIndexFlags_Listed : entry.flags;
+					if (node.kind == EntryKind::File)
+						entry.size = nodes.Size(live);
+					else
+					{
+						uint64_t size;
+						if (folderSize(live, size))
+							entry.size = size;
+					}
+				}
+
+				out.push_back(entry);
+				sources.push_back({ live, old });
+			};
+
+			std::vector<NodeId> liveRoots = nodes.Roots();
+			uint32_t oldRoots = m_Header ? m_Header->rootCount : 0;
+			std::vector<bool> oldRootUsed(oldRoots, false);
+			for (NodeId root : liveRoots)
+			{
+				uint32_t old = InvalidSnapshotIndex;
+				for (uint32_t i = 0; i < oldRoots; i++)
+				{
+					if (NamesEqual(Name(i), nodes.Name(root)))
+					{
+						old = i;
+						oldRootUsed[i] = true;
+						break;
+					}
+				}
+				add(InvalidSnapshotIndex, root, old, nodes.Name(root));
+			}
+			for (uint32_t i = 0; i < oldRoots; i++)
+			{
+				if (!oldRootUsed[i])
+					add(InvalidSnapshotIndex, InvalidNode, i, Name(i));
+			}
+			uint32_t rootCount = (uint32_t)out.size();
+
+			std::unordered_map<std::string_view, uint32_t> oldChildren;
+			std::unordered_map<std::string_view, bool> liveChildren;
+			for (size_t i = 0; i < out.size(); i++)
+			{
+				auto [live, old] = sources[i];
+				uint32_t first = (uint32_t)out.size();
+
+				oldChildren.clear();
+				if (old != InvalidSnapshotIndex)
+				{
+					const NameIndexEntry& entry = m_Entries[old];
+					for (uint32_t c = 0; c < entry.childCount; c++)
+						oldChildren.emplace(Name(entry.firstChild + c), entry.firstChild + c);
+				}
+
+				liveChildren.clear();
+				if (live != InvalidNode)
+				{
+					nodes.ForEachChild(live, [&](NodeId child) {
+						std::string_view name = nodes.Name(child);
+						auto it = oldChildren.find(name);
+						bool sameKind = it != oldChildren.end() && m_Entries[it->second].kind == nodes.Get(child).kind;
+						add((uint32_t)i, child, sameKind ? it->second : InvalidSnapshotIndex, name);
+						liveChildren.emplace(name, true);
+					});
+				}
+
+				bool listed = live != InvalidNode && nodes.Listed(live);
+				if (!listed && old != InvalidSnapshotIndex)
+				{
+					const NameIndexEntry& entry = m_Entries[old];
+					for (uint32_t c = 0; c < entry.childCount; c++)
+					{
+						uint32_t child = entry.firstChild + c;
+						if (!liveChildren.count(Name(child)))
+							add((uint32_t)i, InvalidNode, child, Name(child));
+					}
+				}
+
+				out[i].firstChild = first;
+				out[i].childCount = (uint32_t)out.size() - first;
+			}
+			return rootCount;
+		}
+
+		mutable std::shared_mutex m_Mutex;
+		std::mutex m_BuildMutex;
+		std::string m_Path = NAME_INDEX_FILE;
+
+		MappedFile m_File;
+		const NameIndexHeader* m_Header = nullptr;
+		const NameIndexEntry* m_Entries = nullptr;
+		const char* m_Names = nullptr;
+		const TrigramPosting* m_Trigrams = nullptr;
+		const uint8_t* m_Postings = nullptr;
+		FoldedNameTable m_Folded;
+
+		double m_LoadMs = 0.0;
+		double m_BuildMs = 0.0;
+		std::atomic<double> m_QueryMs{ 0.0 };
+		std::atomic<uint32_t> m_Candidates{ 0 };
+	};
+
+}
\ No newline at end of file
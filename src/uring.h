@@ -0,0 +1,235 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_DEPTH 256
+
+namespace File {
+
+	// Just enough io_uring for batched metadata calls, without liburing. One
+	// ring per thread; nothing here is thread safe.
+	class IoRing {
+	public:
+		IoRing() = default;
+		IoRing(const IoRing&) = delete;
+		IoRing& operator=(const IoRing&) = delete;
+
+		~IoRing()
+		{
+			if (m_Sqes)
+				munmap(m_Sqes, m_SqesSize);
+			if (m_CqRing && m_CqRing != m_SqRing)
+				munmap(m_CqRing, m_CqRingSize);
+			if (m_SqRing)
+				munmap(m_SqRing, m_SqRingSize);
+			if (m_Fd >= 0)
+				close(m_Fd);
+		}
+
+		bool Init(unsigned entries = URING_DEPTH)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+			m_Fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+			if (m_Fd < 0)
+				return false;
+
+			m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMap)
+				m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+			m_SqRing = Map(m_SqRingSize, IORING_OFF_SQ_RING);
+			m_CqRing = singleMap ? m_SqRing : Map(m_CqRingSize, IORING_OFF_CQ_RING);
+			m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			m_Sqes = (io_uring_sqe*)Map(m_SqesSize, IORING_OFF_SQES);
+			if (!m_SqRing || !m_CqRing || !m_Sqes)
+				return false;
+
+			char* sq = (char*)m_SqRing;
+			m_SqHead = (unsigned*)(sq + params.sq_off.head);
+			m_SqTail = (unsigned*)(sq + params.sq_off.tail);
+			m_SqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+			m_SqArray = (unsigned*)(sq + params.sq_off.array);
+
+			char* cq = (char*)m_CqRing;
+			m_CqHead = (unsigned*)(cq + params.cq_off.head);
+			m_CqTail = (unsigned*)(cq + params.cq_off.tail);
+			m_CqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+			m_Cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+			m_Entries = params.sq_entries;
+			return true;
+		}
+
+		bool Valid() const { return m_Sqes != nullptr; }
+		unsigned Capacity() const { return m_Entries; }
+
+		// Zeroed slot for the next request, or nullptr if the ring is full.
+		io_uring_sqe* NextSqe()
+		{
+			unsigned head = std::atomic_ref<unsigned>(*m_SqHead).load(std::memory_order_acquire);
+			if (m_Tail - head >= m_Entries)
+				return nullptr;
+
+			unsigned index = m_Tail & m_SqMask;
+			io_uring_sqe* sqe = &m_Sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			m_SqArray[index] = index;
+			m_Tail++;
+			return sqe;
+		}
+
+		// Publishes every queued request and waits until `waitFor` have completed.
+		int Submit(unsigned waitFor)
+		{
+			std::atomic_ref<unsigned>(*m_SqTail).store(m_Tail, std::memory_order_release);
+			unsigned toSubmit = m_Tail - m_Submitted;
+			int result = (int)syscall(__NR_io_uring_enter, m_Fd, toSubmit, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+			m_Enters++;
+			if (result >= 0)
+				m_Submitted += (unsigned)result;
+			return result;
+		}
+
+		// io_uring_enter calls made so far, for telemetry
+		uint64_t EnterCount() const { return m_Enters; }
+
+		// Calls fn(cqe) for every completion that is ready.
+		template<typename Fn>
+		unsigned Reap(Fn&& fn)
+		{
+			unsigned head = *m_CqHead;
+			unsigned tail = std::atomic_ref<unsigned>(*m_CqTail).load(std::memory_order_acquire);
+			unsigned count = 0;
+			for (; head != tail; head++, count++)
+				fn(m_Cqes[head & m_CqMask]);
+			std::atomic_ref<unsigned>(*m_CqHead).store(head, std::memory_order_release);
+			m_Completed += count;
+			return count;
+		}
+
+		// After a failed Submit: withdraws the requests the kernel never took
+		// and waits out the ones it did, discarding their completions, so the
+		// ring no longer points at the caller's buffers.
+		void Abandon()
+		{
+			m_Tail = m_Submitted;
+			std::atomic_ref<unsigned>(*m_SqTail).store(m_Tail, std::memory_order_release);
+			while (m_Completed != m_Submitted)
+			{
+				if (Reap([](const io_uring_cqe&) {}) != 0)
+					continue;
+				// Even if this fails, entering runs the task work that posts completions
+				syscall(__NR_io_uring_enter, m_Fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+				m_Enters++;
+			}
+		}
+
+	private:
+		void* Map(size_t size, uint64_t offset)
+		{
+			void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, (off_t)offset);
+			return memory == MAP_FAILED ? nullptr : memory;
+		}
+
+		int m_Fd = -1;
+		unsigned m_Entries = 0;
+
+		void* m_SqRing = nullptr;
+		void* m_CqRing = nullptr;
+		size_t m_SqRingSize = 0;
+		size_t m_CqRingSize = 0;
+		io_uring_sqe* m_Sqes = nullptr;
+		size_t m_SqesSize = 0;
+
+		unsigned* m_SqHead = nullptr;
+		unsigned* m_SqTail = nullptr;
+		unsigned* m_SqArray = nullptr;
+		unsigned m_SqMask = 0;
+		unsigned m_Tail = 0;
+		unsigned m_Submitted = 0;
+		unsigned m_Completed = 0;
+		uint64_t m_Enters = 0;
+
+		unsigned* m_CqHead = nullptr;
+		unsigned* m_CqTail = nullptr;
+		unsigned m_CqMask = 0;
+		io_uring_cqe* m_Cqes = nullptr;
+	};
+
+	// The calling thread's ring, or nullptr when io_uring can't be used here
+	// (old kernel, or blocked by seccomp as in many containers).
+	static IoRing* ThreadRing()
+	{
+		static std::atomic<bool> unavailable{ false };
+		static thread_local IoRing ring;
+		static thread_local bool tried = false;
+
+		if (!tried && !unavailable.load(std::memory_order_relaxed))
+		{
+			tried = true;
+			if (!ring.Init())
+				unavailable = true;
+		}
+		return ring.Valid() ? &ring : nullptr;
+	}
+
+	static bool IoUringAvailable() { return ThreadRing() != nullptr; }
+
+	// stat()s `count` entries of `dirfd` with up to a ring's worth of statx
+	// calls in flight. `errors[i]` is 0 or the errno of entry i. On false
+	// nothing is left queued or in flight.
+	static bool BatchStatx(IoRing& ring, int dirfd, const char* const* names, struct statx* results, int* errors, size_t count)
+	{
+		size_t queued = 0;
+		size_t completed = 0;
+		while (completed < count)
+		{
+			size_t inFlight = queued - completed;
+			while (queued < count && inFlight < ring.Capacity())
+			{
+				io_uring_sqe* sqe = ring.NextSqe();
+				if (!sqe)
+					break;
+
+				sqe->opcode = IORING_OP_STATX;
+				sqe->fd = dirfd;
+				sqe->addr = (uint64_t)(uintptr_t)names[queued];
+				sqe->len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+				sqe->off = (uint64_t)(uintptr_t)&results[queued];
+				sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+				sqe->user_data = queued;
+				queued++;
+				inFlight++;
+			}
+
+			if (ring.Submit(1) < 0 && errno != EINTR)
+			{
+				ring.Abandon();
+				return false;
+			}
+
+			completed += ring.Reap([errors](const io_uring_cqe& cqe) {
+				errors[cqe.user_data] = cqe.res < 0 ? -cqe.res : 0;
+			});
+		}
+		return true;
+	}
+
+}
+
+#endif
\ No newline at end of file
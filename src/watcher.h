@@ -0,0 +1,423 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "nodes.h"
+
+#define WATCH_DEBOUNCE_MS 250 // quiet time before a batch of changes is handed on
+#define WATCH_MAX_DELAY_MS 1000 // ...but never hold changes longer than this
+#define WATCH_BUFFER_SIZE (64 * 1024)
+#define WATCH_LIMIT 65536 // most inotify watches to hold, one per folder
+
+namespace File {
+
+	// Filesystem change notifications, coalesced per folder. A raw event only
+	// marks the folder it happened in; once events have been quiet for
+	// WATCH_DEBOUNCE_MS the marked folders are handed to `onChanged` on the
+	// watcher thread. `overflow` means the system dropped events.
+	// Windows watches whole drives with ReadDirectoryChangesW. inotify has no
+	// recursive watch, so on Linux every folder is watched on its own.
+	class ChangeWatcher {
+	public:
+		using Callback = std::function<void(const std::vector<std::string>& directories, bool overflow)>;
+
+		ChangeWatcher() = default;
+		ChangeWatcher(const ChangeWatcher&) = delete;
+		ChangeWatcher& operator=(const ChangeWatcher&) = delete;
+
+		~ChangeWatcher() { Stop(); }
+
+		bool Start(Callback onChanged)
+		{
+			if (m_Thread.joinable())
+				return true;
+
+			m_OnChanged = std::move(onChanged);
+			m_Stop = false;
+#ifdef _WIN32
+			m_Wake = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+			if (!m_Wake)
+				return false;
+#else
+			m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (m_Inotify < 0 || pipe2(m_WakePipe, O_NONBLOCK | O_CLOEXEC) != 0)
+			{
+				std::cerr << "inotify unavailable, folder changes won't be picked up\n";
+				Stop();
+				return false;
+			}
+#endif
+			m_Thread = std::thread(&ChangeWatcher::Run, this);
+			return true;
+		}
+
+		void Stop()
+		{
+			m_Stop = true;
+			Wake();
+			if (m_Thread.joinable())
+				m_Thread.join();
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+#ifdef _WIN32
+			for (auto& watch : m_Drives)
+			{
+				CancelIoEx(watch->handle, &watch->overlapped);
+				DWORD bytes;
+				GetOverlappedResult(watch->handle, &watch->overlapped, &bytes, TRUE);
+				CloseHandle(watch->overlapped.hEvent);
+				CloseHandle(watch->handle);
+			}
+			m_Drives.clear();
+			m_DriveMask = 0;
+			if (m_Wake)
+				CloseHandle(m_Wake);
+			m_Wake = nullptr;
+#else
+			if (m_Inotify >= 0)
+				close(m_Inotify);
+			for (int& fd : m_WakePipe)
+			{
+				if (fd >= 0)
+					close(fd);
+				fd = -1;
+			}
+			m_Inotify = -1;
+			m_Paths.clear();
+			m_Watched.clear();
+			m_Full = false;
+#endif
+		}
+
+		bool Running() const { return m_Thread.joinable(); }
+
+		// Starts watching `directory` (on Windows: the whole drive it is on).
+		void Watch(const std::string& directory)
+		{
+#ifdef _WIN32
+			if (directory.size() < 2 || directory[1] != ':' || !m_Wake)
+				return;
+
+			// Called for every folder read, so skip the lock once a drive is known
+			char letter = (char)std::toupper((unsigned char)directory[0]);
+			uint32_t bit = letter >= 'A' && letter <= 'Z' ? 1u << (letter - 'A') : 0;
+			if (!bit || (m_DriveMask.load(std::memory_order_relaxed) & bit))
+				return;
+
+			std::string root = directory.substr(0, 2);
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if ((m_DriveMask.fetch_or(bit) & bit) || m_Drives.size() + 1 >= MAXIMUM_WAIT_OBJECTS)
+				return;
+
+			auto watch = std::make_unique<DriveWatch>();
+			watch->root = root;
+			watch->handle = CreateFileA((root + PATH_SEPARATOR).c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+				OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+			if (watch->handle == INVALID_HANDLE_VALUE)
+				return;
+
+			watch->overlapped = {};
+			watch->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+			watch->buffer = std::make_unique<DWORD[]>(WATCH_BUFFER_SIZE / sizeof(DWORD));
+			if (!Issue(*watch))
+			{
+				CloseHandle(watch->overlapped.hEvent);
+				CloseHandle(watch->handle);
+				return;
+			}
+
+			m_Drives.push_back(std::move(watch));
+			Wake(); // so the thread waits on the new handle too
+#else
+			// Out of watches: skip the lock until one is given back
+			if (m_Full.load(std::memory_order_relaxed))
+				return;
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Inotify < 0 || m_Watched.count(directory))
+				return;
+
+			if (m_Watched.size() >= WATCH_LIMIT)
+			{
+				if (!m_LimitReported)
+					std::cerr << "Watching " << WATCH_LIMIT << " folders, changes to any further ones won't be picked up\n";
+				m_LimitReported = true;
+				m_Full = true;
+				return;
+			}
+
+			int wd = inotify_add_watch(m_Inotify, directory.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE | IN_ONLYDIR);
+			if (wd < 0)
+			{
+				if (errno == ENOSPC && !m_LimitReported)
+				{
+					std::cerr << "Out of inotify watches (fs.inotify.max_user_watches)\n";
+					m_LimitReported = true;
+				}
+				if (errno == ENOSPC)
+					m_Full = true;
+				return;
+			}
+
+			m_Paths[wd] = directory;
+			m_Watched.insert(directory);
+#endif
+		}
+
+		size_t WatchCount() const
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+#ifdef _WIN32
+			return m_Drives.size();
+#else
+			return m_Watched.size();
+#endif
+		}
+
+		// Raw events received, and coalesced batches handed on
+		uint64_t EventCount() const { return m_Events; }
+		uint64_t BatchCount() const { return m_Batches; }
+
+	private:
+		void Wake()
+		{
+#ifdef _WIN32
+			if (m_Wake)
+				SetEvent(m_Wake);
+#else
+			if (m_WakePipe[1] >= 0)
+			{
+				char byte = 0;
+				(void)!write(m_WakePipe[1], &byte, 1);
+			}
+#endif
+		}
+
+		void Mark(std::string directory)
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (m_Pending.empty() && !m_Overflow)
+				m_FirstEvent = now;
+			m_LastEvent = now;
+			m_Pending.insert(std::move(directory));
+			m_Events++;
+		}
+
+		// Hands on the marked folders once they've been quiet long enough.
+		// Returns how long to wait before checking again.
+		int Flush()
+		{
+			if (m_Pending.empty() && !m_Overflow)
+				return -1;
+
+			auto now = std::chrono::steady_clock::now();
+			auto quiet = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_LastEvent).count();
+			auto held = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_FirstEvent).count();
+			if (quiet < WATCH_DEBOUNCE_MS && held < WATCH_MAX_DELAY_MS)
+				return (int)std::min<long long>(WATCH_DEBOUNCE_MS - quiet, WATCH_MAX_DELAY_MS - held);
+
+			std::vector<std::string> directories(m_Pending.begin(), m_Pending.end());
+			bool overflow = m_Overflow;
+			m_Pending.clear();
+			m_Overflow = false;
+			m_Batches++;
+
+			try
+			{
+				if (m_OnChanged)
+					m_OnChanged(directories, overflow);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << "\n";
+			}
+			return -1;
+		}
+
+#ifdef _WIN32
+		struct DriveWatch {
+			std::string root;
+			HANDLE handle = INVALID_HANDLE_VALUE;
+			OVERLAPPED overlapped;
+			std::unique_ptr<DWORD[]> buffer;
+		};
+
+		static bool Issue(DriveWatch& watch)
+		{
+			return ReadDirectoryChangesW(watch.handle, watch.buffer.get(), WATCH_BUFFER_SIZE, TRUE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+				nullptr, &watch.overlapped, nullptr);
+		}
+
+		void Read(DriveWatch& watch)
+		{
+			DWORD bytes = 0;
+			GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, FALSE);
+			ResetEvent(watch.overlapped.hEvent);
+
+			// Zero bytes means the buffer overflowed and the events are gone
+			if (bytes == 0)
+			{
+				if (m_Pending.empty() && !m_Overflow)
+					m_FirstEvent = std::chrono::steady_clock::now();
+				m_LastEvent = std::chrono::steady_clock::now();
+				m_Overflow = true;
+			}
+
+			const char* data = (const char*)watch.buffer.get();
+			for (DWORD offset = 0; bytes != 0 && offset < bytes;)
+			{
+				const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)(data + offset);
+
+				char name[MAX_PATH * 4];
+				int length = WideCharToMultiByte(CP_ACP, 0, info->FileName, (int)(info->FileNameLength / sizeof(WCHAR)), name, sizeof(name), nullptr, nullptr);
+
+				// Every action changes the listing of the folder the entry is in
+				std::string path = watch.root + PATH_SEPARATOR + std::string(name, length > 0 ? length : 0);
+				size_t separator = path.find_last_of(PATH_SEPARATOR);
+				Mark(separator > watch.root.size() ? path.substr(0, separator) : watch.root);
+
+				if (info->NextEntryOffset == 0)
+					break;
+				offset += info->NextEntryOffset;
+			}
+
+			Issue(watch);
+		}
+
+		void Run()
+		{
+			int timeout = -1;
+			while (!m_Stop)
+			{
+				std::vector<HANDLE> handles = { m_Wake };
+				std::vector<DriveWatch*> drives;
+				{
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					for (auto& watch : m_Drives)
+					{
+						handles.push_back(watch->overlapped.hEvent);
+						drives.push_back(watch.get());
+					}
+				}
+
+				DWORD result = WaitForMultipleObjects((DWORD)handles.size(), handles.data(), FALSE, timeout < 0 ? INFINITE : (DWORD)timeout);
+				if (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handles.size())
+					Read(*drives[result - WAIT_OBJECT_0 - 1]);
+
+				timeout = Flush();
+			}
+		}
+
+		std::vector<std::unique_ptr<DriveWatch>> m_Drives;
+		std::atomic<uint32_t> m_DriveMask{ 0 }; // drive letters already tried
+		HANDLE m_Wake = nullptr;
+#else
+		void Read()
+		{
+			alignas(struct inotify_event) char buffer[WATCH_BUFFER_SIZE];
+			while (true)
+			{
+				ssize_t length = read(m_Inotify, buffer, sizeof(buffer));
+				if (length <= 0)
+					return;
+
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				for (ssize_t offset = 0; offset < length;)
+				{
+					const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+					offset += sizeof(struct inotify_event) + event->len;
+
+					if (event->mask & IN_Q_OVERFLOW)
+					{
+						if (m_Pending.empty() && !m_Overflow)
+							m_FirstEvent = std::chrono::steady_clock::now();
+						m_LastEvent = std::chrono::steady_clock::now();
+						m_Overflow = true;
+						continue;
+					}
+
+					auto it = m_Paths.find(event->wd);
+					if (it == m_Paths.end())
+						continue;
+
+					// The folder itself is gone; its parent gets its own event
+					if (event->mask & IN_IGNORED)
+					{
+						m_Watched.erase(it->second);
+						m_Paths.erase(it);
+						m_Full = false;
+						continue;
+					}
+
+					Mark(it->second);
+				}
+			}
+		}
+
+		void Run()
+		{
+			int timeout = -1;
+			while (!m_Stop)
+			{
+				pollfd fds[2] = { { m_Inotify, POLLIN, 0 }, { m_WakePipe[0], POLLIN, 0 } };
+				if (poll(fds, 2, timeout) > 0)
+				{
+					if (fds[1].revents & POLLIN)
+					{
+						char drain[64];
+						while (read(m_WakePipe[0], drain, sizeof(drain)) > 0) {}
+					}
+					if (fds[0].revents & POLLIN)
+						Read();
+				}
+
+				timeout = Flush();
+			}
+		}
+
+		int m_Inotify = -1;
+		int m_WakePipe[2] = { -1, -1 };
+		std::unordered_map<int, std::string> m_Paths;
+		std::unordered_set<std::string> m_Watched;
+		bool m_LimitReported = false;
+		std::atomic<bool> m_Full{ false }; // WATCH_LIMIT or the system's limit reached
+#endif
+
+		Callback m_OnChanged;
+		std::thread m_Thread;
+		std::atomic<bool> m_Stop{ false };
+		mutable std::mutex m_Mutex;
+
+		// Only touched by the watcher thread
+		std::set<std::string> m_Pending;
+		bool m_Overflow = false;
+		std::chrono::steady_clock::time_point m_FirstEvent;
+		std::chrono::steady_clock::time_point m_LastEvent;
+
+		std::atomic<uint64_t> m_Events{ 0 };
+		std::atomic<uint64_t> m_Batches{ 0 };
+	};
+
+}
\ No newline at end of file